@@ -0,0 +1,562 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Read-ahead over a ring of buffers. 'queue_depth' reads are kept in flight
+// while the consumer works on the one buffer it holds, and buffers are handed
+// out strictly in file order. Backends are io_uring where the kernel allows it
+// and a small pool of threads doing positional reads everywhere else.
+//
+
+#if defined(__linux__)
+  #include <linux/io_uring.h>
+  #include <sys/uio.h>
+  #include <errno.h>
+#endif
+
+enum Async_Io_Backend
+{
+    Async_Io_Backend_Auto,
+    Async_Io_Backend_Io_Uring,
+    Async_Io_Backend_Threads,
+};
+
+enum Async_Slot_State
+{
+    Async_Slot_State_Idle,
+    Async_Slot_State_Queued,
+    Async_Slot_State_Done,
+};
+
+struct Async_Slot
+{
+    u8 *data;
+    u64 offset;
+    mmm requested_size;
+    mmm size;
+    volatile Async_Slot_State state;
+#if defined(__linux__)
+    struct iovec iov;
+#endif
+};
+
+#define ASYNC_IO_MAX_WORKERS 8
+#define ASYNC_IO_POLL_SIZE   KB(64)     // How much of a buffer the consumer works through between async_reader_poll()s.
+
+struct Async_Reader;
+struct Async_Worker
+{
+    Async_Reader *reader;
+    Platform_Thread thread;
+};
+
+#if defined(__linux__)
+struct Io_Uring
+{
+    int fd;
+
+    u32 *sq_head;
+    u32 *sq_tail;
+    u32 *sq_mask;
+    u32 *sq_array;
+    struct io_uring_sqe *sqes;
+
+    u32 *cq_head;
+    u32 *cq_tail;
+    u32 *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    mmm sq_ring_size;
+    void *cq_ring;
+    mmm cq_ring_size;
+    mmm sqes_size;
+};
+#endif
+
+struct Async_Reader
+{
+    Async_Io_Backend backend;
+    Platform_File file;
+    u64 file_size;
+
+    mmm buffer_size;
+    u32 slot_count;
+    Async_Slot *slots;
+
+    u64 next_submit_offset;
+    u32 next_submit_slot;
+    u32 next_consume_slot;
+    b32 holding_slot;
+
+    // Thread backend.
+    Platform_Mutex mutex;
+    Platform_Condition work_available;
+    Platform_Condition work_done;
+    u32 queue[64];
+    u32 queue_read;
+    u32 queue_write;
+    b32 shutting_down;
+    u32 worker_count;
+    Async_Worker workers[ASYNC_IO_MAX_WORKERS];
+
+#if defined(__linux__)
+    Io_Uring ring;
+#endif
+
+    // @NOTE: io_busy_tsc is wall time with at least one read outstanding;
+    // whatever part of it the consumer didn't spend in wait_tsc was hidden.
+    // Reader threads stamp their completions as they land. io_uring ones are
+    // stamped when the consumer sees them, which is why it polls every
+    // ASYNC_IO_POLL_SIZE bytes instead of only between buffers.
+    u32 in_flight_count;
+    u64 in_flight_since_tsc;
+    u64 io_busy_tsc;
+    u64 wait_tsc;
+    u64 read_count;
+    u64 bytes_read;
+};
+
+static void
+async_note_submitted(Async_Reader *reader)
+{
+    if (reader->in_flight_count++ == 0)
+        reader->in_flight_since_tsc = read_cpu_timer();
+}
+
+static void
+async_note_completed(Async_Reader *reader, Async_Slot *slot, mmm size)
+{
+    slot->size = size;
+    slot->state = Async_Slot_State_Done;
+
+    ++reader->read_count;
+    reader->bytes_read += size;
+    if (--reader->in_flight_count == 0)
+        reader->io_busy_tsc += read_cpu_timer() - reader->in_flight_since_tsc;
+}
+
+//
+// io_uring backend
+//
+
+#if defined(__linux__)
+static b32
+io_uring_init(Io_Uring *ring, u32 entries)
+{
+    *ring = {};
+
+    struct io_uring_params params = {};
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+        return false;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(0, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        close(ring->fd);
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(0, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            close(ring->fd);
+            return false;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(0, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cq_ring != ring->sq_ring)
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return false;
+    }
+
+    u8 *sq = (u8 *)ring->sq_ring;
+    ring->sq_head  = (u32 *)(sq + params.sq_off.head);
+    ring->sq_tail  = (u32 *)(sq + params.sq_off.tail);
+    ring->sq_mask  = (u32 *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (u32 *)(sq + params.sq_off.array);
+
+    u8 *cq = (u8 *)ring->cq_ring;
+    ring->cq_head = (u32 *)(cq + params.cq_off.head);
+    ring->cq_tail = (u32 *)(cq + params.cq_off.tail);
+    ring->cq_mask = (u32 *)(cq + params.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+static void
+io_uring_shutdown(Io_Uring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+static void
+io_uring_submit_read(Async_Reader *reader, u32 slot_index)
+{
+    Io_Uring *ring = &reader->ring;
+    Async_Slot *slot = reader->slots + slot_index;
+
+    slot->iov.iov_base = slot->data;
+    slot->iov.iov_len = slot->requested_size;
+
+    u32 tail = *ring->sq_tail;
+    u32 index = tail & *ring->sq_mask;
+
+    struct io_uring_sqe *sqe = ring->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = reader->file.fd;
+    sqe->addr = (u64)&slot->iov;
+    sqe->len = 1;
+    sqe->off = slot->offset;
+    sqe->user_data = slot_index;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    for (;;)
+    {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, 0, 0);
+        if (submitted > 0)
+            return;
+        if (submitted < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        break;
+    }
+
+    // @NOTE: The kernel didn't take the entry, and it only looks at the SQ
+    // inside io_uring_enter, so the entry is withdrawn and the read done here.
+    // Otherwise the slot would stay queued with no completion ever coming.
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    mmm size = read_file_at(&reader->file, slot->offset, slot->data, slot->requested_size);
+    async_note_completed(reader, slot, size);
+}
+
+// Reaps whatever completions are already posted; blocks for at least one if 'wait' is set.
+static void
+io_uring_reap(Async_Reader *reader, b32 wait)
+{
+    Io_Uring *ring = &reader->ring;
+    if (wait)
+        syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+
+    u32 head = *ring->cq_head;
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe *cqe = ring->cqes + (head & *ring->cq_mask);
+        Async_Slot *slot = reader->slots + cqe->user_data;
+
+        // @NOTE: Regular files only come back short at EOF, but if one does
+        // anyway, the rest is finished with a blocking read.
+        mmm size = (cqe->res > 0) ? (mmm)cqe->res : 0;
+        if (size < slot->requested_size)
+            size += read_file_at(&reader->file, slot->offset + size, slot->data + size, slot->requested_size - size);
+
+        async_note_completed(reader, slot, size);
+        ++head;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+//
+// Thread backend
+//
+
+static void
+async_worker_proc(void *param)
+{
+    Async_Worker *worker = (Async_Worker *)param;
+    Async_Reader *reader = worker->reader;
+
+    begin_profile_thread("async io");
+    lock_mutex(&reader->mutex);
+    for (;;)
+    {
+        while (reader->queue_read == reader->queue_write && !reader->shutting_down)
+            wait_condition(&reader->work_available, &reader->mutex);
+
+        if (reader->queue_read == reader->queue_write)
+            break;
+
+        u32 slot_index = reader->queue[reader->queue_read++ % array_count(reader->queue)];
+        Async_Slot *slot = reader->slots + slot_index;
+        unlock_mutex(&reader->mutex);
+
+        mmm size = read_file_at(&reader->file, slot->offset, slot->data, slot->requested_size);
+
+        lock_mutex(&reader->mutex);
+        async_note_completed(reader, slot, size);
+        broadcast_condition(&reader->work_done);
+    }
+    unlock_mutex(&reader->mutex);
+
+    release_scratch_arenas();
+}
+
+//
+// Reader
+//
+
+static void
+async_submit_next(Async_Reader *reader)
+{
+    if (reader->next_submit_offset < reader->file_size)
+    {
+        u32 slot_index = reader->next_submit_slot;
+        reader->next_submit_slot = (slot_index + 1) % reader->slot_count;
+
+        Async_Slot *slot = reader->slots + slot_index;
+        assert(slot->state == Async_Slot_State_Idle);
+
+        u64 remaining = reader->file_size - reader->next_submit_offset;
+        slot->offset = reader->next_submit_offset;
+        slot->requested_size = (remaining < reader->buffer_size) ? (mmm)remaining : reader->buffer_size;
+        slot->size = 0;
+        slot->state = Async_Slot_State_Queued;
+        reader->next_submit_offset += slot->requested_size;
+
+        switch (reader->backend)
+        {
+#if defined(__linux__)
+            case Async_Io_Backend_Io_Uring:
+            {
+                async_note_submitted(reader);
+                io_uring_submit_read(reader, slot_index);
+            } break;
+#endif
+
+            case Async_Io_Backend_Threads:
+            {
+                lock_mutex(&reader->mutex);
+                async_note_submitted(reader);
+                reader->queue[reader->queue_write++ % array_count(reader->queue)] = slot_index;
+                signal_condition(&reader->work_available);
+                unlock_mutex(&reader->mutex);
+            } break;
+
+            invalid_default_case;
+        }
+    }
+}
+
+static b32
+open_async_reader(Async_Reader *reader, const char *filename, mmm buffer_size, u32 queue_depth,
+                  Async_Io_Backend backend, Memory_Arena *arena)
+{
+    *reader = {};
+    if (!open_file_for_reading(&reader->file, filename))
+        return false;
+
+    if (queue_depth < 1)
+        queue_depth = 1;
+    if (queue_depth > array_count(reader->queue) - 1)
+        queue_depth = array_count(reader->queue) - 1;
+
+    reader->file_size = get_file_size(&reader->file);
+    reader->buffer_size = buffer_size;
+    reader->slot_count = queue_depth + 1;
+    reader->slots = push_array(arena, Async_Slot, reader->slot_count);
+
+    mmm page_size = get_page_size();
+    u8 *buffers = (u8 *)push_size(arena, reader->slot_count * buffer_size + page_size);
+    buffers = (u8 *)(((umm)buffers + page_size - 1) & ~(umm)(page_size - 1));
+    for (u32 slot_index = 0; slot_index < reader->slot_count; ++slot_index)
+    {
+        reader->slots[slot_index] = {};
+        reader->slots[slot_index].data = buffers + slot_index * buffer_size;
+    }
+
+#if defined(__linux__)
+    if (backend == Async_Io_Backend_Auto || backend == Async_Io_Backend_Io_Uring)
+    {
+        if (io_uring_init(&reader->ring, reader->slot_count))
+            reader->backend = Async_Io_Backend_Io_Uring;
+    }
+#endif
+
+    if (reader->backend != Async_Io_Backend_Io_Uring)
+        reader->backend = Async_Io_Backend_Threads;
+
+    if (reader->backend == Async_Io_Backend_Threads)
+    {
+        init_mutex(&reader->mutex);
+        init_condition(&reader->work_available);
+        init_condition(&reader->work_done);
+
+        reader->worker_count = (queue_depth < ASYNC_IO_MAX_WORKERS) ? queue_depth : ASYNC_IO_MAX_WORKERS;
+        for (u32 worker_index = 0; worker_index < reader->worker_count; ++worker_index)
+        {
+            Async_Worker *worker = reader->workers + worker_index;
+            worker->reader = reader;
+            create_thread(&worker->thread, async_worker_proc, worker);
+        }
+    }
+
+    for (u32 read_index = 0; read_index < queue_depth; ++read_index)
+        async_submit_next(reader);
+
+    return true;
+}
+
+// Picks up io_uring completions that landed since the last look, without
+// blocking. The thread backend needs nothing here.
+static void
+async_reader_poll(Async_Reader *reader)
+{
+#if defined(__linux__)
+    if (reader->backend == Async_Io_Backend_Io_Uring)
+        io_uring_reap(reader, false);
+#endif
+}
+
+// Returns the next part of the file in order, or an empty buffer at EOF. The
+// buffer is valid until the next call, which recycles it for read-ahead.
+static Buffer
+async_reader_next(Async_Reader *reader)
+{
+    Buffer result = {};
+
+    if (reader->holding_slot)
+    {
+        reader->slots[reader->next_consume_slot].state = Async_Slot_State_Idle;
+        reader->next_consume_slot = (reader->next_consume_slot + 1) % reader->slot_count;
+        reader->holding_slot = false;
+        async_submit_next(reader);
+    }
+
+    Async_Slot *slot = reader->slots + reader->next_consume_slot;
+    if (slot->state != Async_Slot_State_Idle)
+    {
+        switch (reader->backend)
+        {
+#if defined(__linux__)
+            case Async_Io_Backend_Io_Uring:
+            {
+                io_uring_reap(reader, false);
+                if (slot->state != Async_Slot_State_Done)
+                {
+                    time_block("async_read_wait");
+                    u64 wait_start = read_cpu_timer();
+                    while (slot->state != Async_Slot_State_Done)
+                        io_uring_reap(reader, true);
+                    reader->wait_tsc += read_cpu_timer() - wait_start;
+                }
+            } break;
+#endif
+
+            case Async_Io_Backend_Threads:
+            {
+                lock_mutex(&reader->mutex);
+                if (slot->state != Async_Slot_State_Done)
+                {
+                    time_block("async_read_wait");
+                    u64 wait_start = read_cpu_timer();
+                    while (slot->state != Async_Slot_State_Done)
+                        wait_condition(&reader->work_done, &reader->mutex);
+                    reader->wait_tsc += read_cpu_timer() - wait_start;
+                }
+                unlock_mutex(&reader->mutex);
+            } break;
+
+            invalid_default_case;
+        }
+
+        result.data = slot->data;
+        result.size = slot->size;
+        reader->holding_slot = true;
+    }
+
+    return result;
+}
+
+static void
+close_async_reader(Async_Reader *reader)
+{
+    switch (reader->backend)
+    {
+#if defined(__linux__)
+        case Async_Io_Backend_Io_Uring:
+        {
+            while (reader->in_flight_count)
+                io_uring_reap(reader, true);
+            io_uring_shutdown(&reader->ring);
+        } break;
+#endif
+
+        case Async_Io_Backend_Threads:
+        {
+            lock_mutex(&reader->mutex);
+            reader->shutting_down = true;
+            broadcast_condition(&reader->work_available);
+            unlock_mutex(&reader->mutex);
+
+            for (u32 worker_index = 0; worker_index < reader->worker_count; ++worker_index)
+                join_thread(&reader->workers[worker_index].thread);
+
+            destroy_condition(&reader->work_done);
+            destroy_condition(&reader->work_available);
+            destroy_mutex(&reader->mutex);
+        } break;
+
+        default: {} break;
+    }
+
+    close_file(&reader->file);
+}
+
+// Adds the read-ahead to the profile: the time reads were in flight, labelled
+// with how much of it the consumer didn't spend waiting. The waits themselves
+// are the async_read_wait blocks.
+static void
+record_async_reader_profile(Async_Reader *reader)
+{
+    local char label[128];
+
+    f64 hidden_percent = 0.0;
+    if (reader->io_busy_tsc > reader->wait_tsc)
+        hidden_percent = 100.0 * (f64)(reader->io_busy_tsc - reader->wait_tsc) / (f64)reader->io_busy_tsc;
+
+    snprintf(label, sizeof(label), "async_read_in_flight (%s, %llu reads, %.2f%% hidden)",
+             (reader->backend == Async_Io_Backend_Io_Uring) ? "io_uring" : "threads",
+             (unsigned long long)reader->read_count, hidden_percent);
+    record_profile_interval(label, reader->io_busy_tsc, reader->bytes_read);
+}
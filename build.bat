@@ -7,6 +7,9 @@ pushd build
 where /q cl && (
     call cl -arch:AVX2 -Od -Zi -W4 -nologo -wd4505 -wd4189 -wd4100 ..\main.cpp -Fe:main.exe -D__PROFILER=1
     call cl -arch:AVX2 -Od -Zi -W4 -nologo -wd4505 -wd4189 -wd4100 ..\haversine_generator.cpp -Fe:haversine_generator.exe
+    call cl -arch:AVX2 -O2 -Zi -W4 -nologo -wd4505 -wd4189 -wd4100 ..\haversine_converter.cpp -Fe:haversine_converter.exe
+    call cl -arch:AVX2 -O2 -Zi -W4 -nologo -wd4505 -wd4189 -wd4100 ..\repetition_test_main.cpp -Fe:repetition_test.exe
+    call cl -arch:AVX2 -O2 -Zi -W4 -nologo -wd4505 -wd4189 -wd4100 ..\math_test_main.cpp -Fe:math_test.exe
 )
 
 popd
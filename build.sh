@@ -0,0 +1,21 @@
+#!/bin/sh
+
+mkdir -p build
+cd build
+
+CXX=${CXX:-g++}
+COMMON_FLAGS="-std=c++17 -mavx2 -g -Wall -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable $CXXFLAGS"
+DEBUG_FLAGS="$COMMON_FLAGS -O0"
+RELEASE_FLAGS="$COMMON_FLAGS -O2"
+
+if command -v $CXX > /dev/null; then
+    $CXX $DEBUG_FLAGS ../main.cpp -o main_debug -D__PROFILER=1 -lm
+    $CXX $RELEASE_FLAGS ../main.cpp -o main_release -D__PROFILER=1 -lm
+    $CXX $DEBUG_FLAGS ../haversine_generator.cpp -o haversine_generator_debug -lm
+    $CXX $RELEASE_FLAGS ../haversine_generator.cpp -o haversine_generator_release -lm
+    $CXX $RELEASE_FLAGS ../haversine_converter.cpp -o haversine_converter -lm
+    $CXX $RELEASE_FLAGS ../repetition_test_main.cpp -o repetition_test -lm
+    $CXX $RELEASE_FLAGS ../math_test_main.cpp -o math_test -lm
+fi
+
+cd ..
@@ -15,16 +15,20 @@
 
     
 #include <stdint.h>
+#include <stddef.h>
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
 
 typedef int8_t  s8;
 typedef int16_t s16;
 typedef int32_t s32;
-typedef int64_t s64;
+typedef long long s64;
 
 typedef uint8_t  u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
-typedef uint64_t u64;
+typedef unsigned long long u64;
 
 typedef float f32;
 typedef double f64;
@@ -53,6 +57,40 @@ typedef intptr_t  smm;
 #define invalid_default_case default: { invalid_code_path; } break
 
 
+static u32
+count_trailing_zeros(u64 value)
+{
+#ifdef _MSC_VER
+    unsigned long result;
+    _BitScanForward64(&result, value);
+    return (u32)result;
+#else
+    return (u32)__builtin_ctzll(value);
+#endif
+}
+
+static u32
+count_leading_zeros(u64 value)
+{
+#ifdef _MSC_VER
+    unsigned long result;
+    _BitScanReverse64(&result, value);
+    return (u32)(63 - result);
+#else
+    return (u32)__builtin_clzll(value);
+#endif
+}
+
+static u32
+count_set_bits(u64 value)
+{
+#ifdef _MSC_VER
+    return (u32)__popcnt64(value);
+#else
+    return (u32)__builtin_popcountll(value);
+#endif
+}
+
 struct Buffer
 {
     mmm size;
@@ -78,6 +116,17 @@ string_length(const char *str)
     return result;
 }
 
+static b32
+string_equal(const char *str1, const char *str2)
+{
+    while (*str1 && (*str1 == *str2))
+    {
+        ++str1;
+        ++str2;
+    }
+    return (*str1 == *str2);
+}
+
 static b32
 operator == (String a, String b)
 {
@@ -98,24 +147,19 @@ operator == (String a, String b)
     }
 }
 
+// @NOTE: Walks both in one pass instead of measuring 'b' first; a mismatch
+// in the first byte costs one compare rather than a strlen.
 static b32
 operator == (String a, const char *b)
 {
-    if (a.size == string_length(b))
+    for (mmm idx = 0; idx < a.size; ++idx)
     {
-        for (u32 idx = 0; idx < a.size; ++idx)
+        if (((char *)a.data)[idx] != b[idx] || b[idx] == 0)
         {
-            if (((char *)a.data)[idx] != b[idx])
-            {
-                return false;
-            }
+            return false;
         }
-        return true;
-    }
-    else
-    {
-        return false;
     }
+    return (b[a.size] == 0);
 }
 
 #endif // CORE_H_
@@ -0,0 +1,497 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Haversine over columns of pairs, 4 (AVX2) or 8 (AVX-512) at a time.
+//
+// The vector kernels are haversine_math.cpp evaluated on whole registers:
+// the same range reduction, polynomials and quadrant select, with FMAs. The
+// kernel is picked once, at the first call, from what the CPU supports. The
+// scalar kernel is plain haversine() in a loop; it handles the tails and CPUs
+// without AVX2, so a pair gets the same answer to within an ulp or two on
+// every path.
+//
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+  #define TARGET_AVX2
+  #define TARGET_AVX512
+#else
+  #define TARGET_AVX2   __attribute__((target("avx2,fma")))
+  #define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+// @NOTE: Over random pairs on the whole globe the batch kernels agree with
+// haversine_libm() to within 6.1e-13 relative. The worst cases are
+// near-antipodal pairs: asin(sqrt(a)) has an infinite slope at a = 1, so
+// last-bit differences in 'a' (libm's rounding as much as ours) get magnified
+// there. Pairs within about 1e-5 degrees of exactly antipodal can go past the
+// limit for that reason alone. validate_haversine_batch() measures it.
+#define HAVERSINE_BATCH_MAX_RELATIVE_ERROR  1e-9
+
+#define HAVERSINE_EARTH_RADIUS  6372.8
+#define HAVERSINE_DEG_TO_RAD    0.01745329251994329577
+
+typedef void Haversine_Batch_Function(const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1, mmm count, f64 *distances);
+
+enum Haversine_Kernel
+{
+    Haversine_Kernel_Scalar,
+    Haversine_Kernel_AVX2,
+    Haversine_Kernel_AVX512,
+
+    Haversine_Kernel_Count,
+};
+
+static void
+haversine_batch_scalar(const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1, mmm count, f64 *distances)
+{
+    for (mmm idx = 0; idx < count; ++idx)
+        distances[idx] = haversine(x0[idx], y0[idx], x1[idx], y1[idx]);
+}
+
+//
+// AVX2 + FMA, 4 lanes
+//
+// @NOTE: The FMA kernels round differently from haversine() in the last bit
+// or so; both are inside the stated error.
+//
+
+TARGET_AVX2 static __m256d
+avx2_sin_quadrant(__m256d x, __m256i quadrant_offset)
+{
+    __m256d magic = _mm256_set1_pd(TRIG_ROUNDING_MAGIC);
+    __m256d t = _mm256_fmadd_pd(x, _mm256_set1_pd(TRIG_TWO_OVER_PI), magic);
+    __m256i quadrant = _mm256_add_epi64(_mm256_castpd_si256(t), quadrant_offset);
+    __m256d k = _mm256_sub_pd(t, magic);
+
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(TRIG_PIO2_1), x);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(TRIG_PIO2_2), r);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(TRIG_PIO2_2T), r);
+    __m256d z = _mm256_mul_pd(r, r);
+
+    __m256d s = _mm256_fmadd_pd(z, _mm256_set1_pd(SIN_C6), _mm256_set1_pd(SIN_C5));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIN_C4));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIN_C3));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIN_C2));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIN_C1));
+    s = _mm256_fmadd_pd(_mm256_mul_pd(r, z), s, r);
+
+    __m256d c = _mm256_fmadd_pd(z, _mm256_set1_pd(COS_C6), _mm256_set1_pd(COS_C5));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(COS_C4));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(COS_C3));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(COS_C2));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(COS_C1));
+    c = _mm256_fmadd_pd(_mm256_mul_pd(z, z), c, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256d use_cos = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one));
+    __m256d result = _mm256_blendv_pd(s, c, use_cos);
+
+    __m256i sign = _mm256_slli_epi64(_mm256_and_si256(quadrant, _mm256_set1_epi64x(2)), 62);
+    return _mm256_xor_pd(result, _mm256_castsi256_pd(sign));
+}
+
+TARGET_AVX2 static __m256d
+avx2_asin(__m256d x)
+{
+    __m256d half = _mm256_set1_pd(0.5);
+    __m256d big = _mm256_cmp_pd(x, half, _CMP_GT_OQ);
+    __m256d z = _mm256_blendv_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), x), half), big);
+    __m256d s = _mm256_blendv_pd(x, _mm256_sqrt_pd(z), big);
+
+    __m256d p = _mm256_fmadd_pd(z, _mm256_set1_pd(ASIN_P5), _mm256_set1_pd(ASIN_P4));
+    p = _mm256_fmadd_pd(z, p, _mm256_set1_pd(ASIN_P3));
+    p = _mm256_fmadd_pd(z, p, _mm256_set1_pd(ASIN_P2));
+    p = _mm256_fmadd_pd(z, p, _mm256_set1_pd(ASIN_P1));
+    p = _mm256_fmadd_pd(z, p, _mm256_set1_pd(ASIN_P0));
+    p = _mm256_mul_pd(z, p);
+
+    __m256d q = _mm256_fmadd_pd(z, _mm256_set1_pd(ASIN_Q4), _mm256_set1_pd(ASIN_Q3));
+    q = _mm256_fmadd_pd(z, q, _mm256_set1_pd(ASIN_Q2));
+    q = _mm256_fmadd_pd(z, q, _mm256_set1_pd(ASIN_Q1));
+    q = _mm256_fmadd_pd(z, q, _mm256_set1_pd(1.0));
+
+    __m256d r = _mm256_fmadd_pd(s, _mm256_div_pd(p, q), s);
+    __m256d reflected = _mm256_sub_pd(_mm256_set1_pd(ASIN_PIO2_HI),
+                                      _mm256_fmsub_pd(_mm256_set1_pd(2.0), r, _mm256_set1_pd(ASIN_PIO2_LO)));
+    return _mm256_blendv_pd(r, reflected, big);
+}
+
+TARGET_AVX2 static void
+haversine_batch_avx2(const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1, mmm count, f64 *distances)
+{
+    __m256d deg_to_rad = _mm256_set1_pd(HAVERSINE_DEG_TO_RAD);
+    __m256d half = _mm256_set1_pd(0.5);
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d diameter = _mm256_set1_pd(2.0 * HAVERSINE_EARTH_RADIUS);
+    __m256i sin_offset = _mm256_setzero_si256();
+    __m256i cos_offset = _mm256_set1_epi64x(1);
+
+    mmm idx = 0;
+    for (; idx + 4 <= count; idx += 4)
+    {
+        __m256d lon0 = _mm256_loadu_pd(x0 + idx);
+        __m256d lat0 = _mm256_loadu_pd(y0 + idx);
+        __m256d lon1 = _mm256_loadu_pd(x1 + idx);
+        __m256d lat1 = _mm256_loadu_pd(y1 + idx);
+
+        __m256d d_lat = _mm256_mul_pd(deg_to_rad, _mm256_sub_pd(lat1, lat0));
+        __m256d d_lon = _mm256_mul_pd(deg_to_rad, _mm256_sub_pd(lon1, lon0));
+
+        __m256d sin_d_lat = avx2_sin_quadrant(_mm256_mul_pd(d_lat, half), sin_offset);
+        __m256d sin_d_lon = avx2_sin_quadrant(_mm256_mul_pd(d_lon, half), sin_offset);
+        __m256d cos_lat0 = avx2_sin_quadrant(_mm256_mul_pd(deg_to_rad, lat0), cos_offset);
+        __m256d cos_lat1 = avx2_sin_quadrant(_mm256_mul_pd(deg_to_rad, lat1), cos_offset);
+
+        __m256d a = _mm256_fmadd_pd(_mm256_mul_pd(cos_lat0, cos_lat1), _mm256_mul_pd(sin_d_lon, sin_d_lon),
+                                    _mm256_mul_pd(sin_d_lat, sin_d_lat));
+        a = _mm256_min_pd(a, one);
+
+        _mm256_storeu_pd(distances + idx, _mm256_mul_pd(diameter, avx2_asin(_mm256_sqrt_pd(a))));
+    }
+
+    haversine_batch_scalar(x0 + idx, y0 + idx, x1 + idx, y1 + idx, count - idx, distances + idx);
+}
+
+//
+// AVX-512F, 8 lanes
+//
+// @NOTE: The shift, min and sqrt here are the masked forms on purpose. GCC 12
+// implements the unmasked ones on top of an uninitialized register and warns
+// at every use.
+//
+
+TARGET_AVX512 static __m512d
+avx512_sin_quadrant(__m512d x, __m512i quadrant_offset)
+{
+    __m512d magic = _mm512_set1_pd(TRIG_ROUNDING_MAGIC);
+    __m512d t = _mm512_fmadd_pd(x, _mm512_set1_pd(TRIG_TWO_OVER_PI), magic);
+    __m512i quadrant = _mm512_add_epi64(_mm512_castpd_si512(t), quadrant_offset);
+    __m512d k = _mm512_sub_pd(t, magic);
+
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(TRIG_PIO2_1), x);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(TRIG_PIO2_2), r);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(TRIG_PIO2_2T), r);
+    __m512d z = _mm512_mul_pd(r, r);
+
+    __m512d s = _mm512_fmadd_pd(z, _mm512_set1_pd(SIN_C6), _mm512_set1_pd(SIN_C5));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIN_C4));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIN_C3));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIN_C2));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIN_C1));
+    s = _mm512_fmadd_pd(_mm512_mul_pd(r, z), s, r);
+
+    __m512d c = _mm512_fmadd_pd(z, _mm512_set1_pd(COS_C6), _mm512_set1_pd(COS_C5));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(COS_C4));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(COS_C3));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(COS_C2));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(COS_C1));
+    c = _mm512_fmadd_pd(_mm512_mul_pd(z, z), c, _mm512_fnmadd_pd(_mm512_set1_pd(0.5), z, _mm512_set1_pd(1.0)));
+
+    __mmask8 use_cos = _mm512_test_epi64_mask(quadrant, _mm512_set1_epi64(1));
+    __m512d result = _mm512_mask_blend_pd(use_cos, s, c);
+
+    __mmask8 negate = _mm512_test_epi64_mask(quadrant, _mm512_set1_epi64(2));
+    __m512i bits = _mm512_castpd_si512(result);
+    return _mm512_castsi512_pd(_mm512_mask_xor_epi64(bits, negate, bits, _mm512_set1_epi64((s64)(1ull << 63))));
+}
+
+TARGET_AVX512 static __m512d
+avx512_asin(__m512d x)
+{
+    __m512d half = _mm512_set1_pd(0.5);
+    __mmask8 big = _mm512_cmp_pd_mask(x, half, _CMP_GT_OQ);
+    __m512d z = _mm512_mask_blend_pd(big, _mm512_mul_pd(x, x), _mm512_mul_pd(_mm512_sub_pd(_mm512_set1_pd(1.0), x), half));
+    __m512d s = _mm512_mask_sqrt_pd(x, big, z);
+
+    __m512d p = _mm512_fmadd_pd(z, _mm512_set1_pd(ASIN_P5), _mm512_set1_pd(ASIN_P4));
+    p = _mm512_fmadd_pd(z, p, _mm512_set1_pd(ASIN_P3));
+    p = _mm512_fmadd_pd(z, p, _mm512_set1_pd(ASIN_P2));
+    p = _mm512_fmadd_pd(z, p, _mm512_set1_pd(ASIN_P1));
+    p = _mm512_fmadd_pd(z, p, _mm512_set1_pd(ASIN_P0));
+    p = _mm512_mul_pd(z, p);
+
+    __m512d q = _mm512_fmadd_pd(z, _mm512_set1_pd(ASIN_Q4), _mm512_set1_pd(ASIN_Q3));
+    q = _mm512_fmadd_pd(z, q, _mm512_set1_pd(ASIN_Q2));
+    q = _mm512_fmadd_pd(z, q, _mm512_set1_pd(ASIN_Q1));
+    q = _mm512_fmadd_pd(z, q, _mm512_set1_pd(1.0));
+
+    __m512d r = _mm512_fmadd_pd(s, _mm512_div_pd(p, q), s);
+    __m512d reflected = _mm512_sub_pd(_mm512_set1_pd(ASIN_PIO2_HI),
+                                      _mm512_fmsub_pd(_mm512_set1_pd(2.0), r, _mm512_set1_pd(ASIN_PIO2_LO)));
+    return _mm512_mask_blend_pd(big, r, reflected);
+}
+
+TARGET_AVX512 static void
+haversine_batch_avx512(const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1, mmm count, f64 *distances)
+{
+    __m512d deg_to_rad = _mm512_set1_pd(HAVERSINE_DEG_TO_RAD);
+    __m512d half = _mm512_set1_pd(0.5);
+    __m512d one = _mm512_set1_pd(1.0);
+    __m512d diameter = _mm512_set1_pd(2.0 * HAVERSINE_EARTH_RADIUS);
+    __m512i sin_offset = _mm512_setzero_si512();
+    __m512i cos_offset = _mm512_set1_epi64(1);
+
+    mmm idx = 0;
+    for (; idx + 8 <= count; idx += 8)
+    {
+        __m512d lon0 = _mm512_loadu_pd(x0 + idx);
+        __m512d lat0 = _mm512_loadu_pd(y0 + idx);
+        __m512d lon1 = _mm512_loadu_pd(x1 + idx);
+        __m512d lat1 = _mm512_loadu_pd(y1 + idx);
+
+        __m512d d_lat = _mm512_mul_pd(deg_to_rad, _mm512_sub_pd(lat1, lat0));
+        __m512d d_lon = _mm512_mul_pd(deg_to_rad, _mm512_sub_pd(lon1, lon0));
+
+        __m512d sin_d_lat = avx512_sin_quadrant(_mm512_mul_pd(d_lat, half), sin_offset);
+        __m512d sin_d_lon = avx512_sin_quadrant(_mm512_mul_pd(d_lon, half), sin_offset);
+        __m512d cos_lat0 = avx512_sin_quadrant(_mm512_mul_pd(deg_to_rad, lat0), cos_offset);
+        __m512d cos_lat1 = avx512_sin_quadrant(_mm512_mul_pd(deg_to_rad, lat1), cos_offset);
+
+        __m512d a = _mm512_fmadd_pd(_mm512_mul_pd(cos_lat0, cos_lat1), _mm512_mul_pd(sin_d_lon, sin_d_lon),
+                                    _mm512_mul_pd(sin_d_lat, sin_d_lat));
+        a = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, one, _CMP_GT_OQ), a, one);
+
+        _mm512_storeu_pd(distances + idx, _mm512_mul_pd(diameter, avx512_asin(_mm512_maskz_sqrt_pd(0xFF, a))));
+    }
+
+    haversine_batch_scalar(x0 + idx, y0 + idx, x1 + idx, y1 + idx, count - idx, distances + idx);
+}
+
+//
+// Dispatch
+//
+
+static const char *
+get_haversine_kernel_name(Haversine_Kernel kernel)
+{
+    const char *result = "unknown";
+    switch (kernel)
+    {
+        case Haversine_Kernel_Scalar: { result = "scalar"; } break;
+        case Haversine_Kernel_AVX2:   { result = "avx2";   } break;
+        case Haversine_Kernel_AVX512: { result = "avx512"; } break;
+        invalid_default_case;
+    }
+    return result;
+}
+
+static b32
+is_haversine_kernel_supported(Haversine_Kernel kernel)
+{
+    Cpu_Features features = get_cpu_features();
+    b32 result = false;
+    switch (kernel)
+    {
+        case Haversine_Kernel_Scalar: { result = true;             } break;
+        case Haversine_Kernel_AVX2:   { result = features.avx2;    } break;
+        case Haversine_Kernel_AVX512: { result = features.avx512f; } break;
+        invalid_default_case;
+    }
+    return result;
+}
+
+static Haversine_Batch_Function *
+get_haversine_batch_function(Haversine_Kernel kernel)
+{
+    Haversine_Batch_Function *result = 0;
+    switch (kernel)
+    {
+        case Haversine_Kernel_Scalar: { result = haversine_batch_scalar; } break;
+        case Haversine_Kernel_AVX2:   { result = haversine_batch_avx2;   } break;
+        case Haversine_Kernel_AVX512: { result = haversine_batch_avx512; } break;
+        invalid_default_case;
+    }
+    return result;
+}
+
+static Haversine_Kernel
+get_best_haversine_kernel(void)
+{
+    Haversine_Kernel result = Haversine_Kernel_Scalar;
+    for (u32 kernel = 0; kernel < Haversine_Kernel_Count; ++kernel)
+    {
+        if (is_haversine_kernel_supported((Haversine_Kernel)kernel))
+            result = (Haversine_Kernel)kernel;
+    }
+    return result;
+}
+
+// Writes the distance of each of the 'count' pairs to 'distances', using the
+// widest kernel the CPU supports.
+static void
+haversine_batch(const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1, mmm count, f64 *distances)
+{
+    // @NOTE: Worker threads can race to fill this in, but they all store the same pointer.
+    local Haversine_Batch_Function *batch_function;
+    if (!batch_function)
+        batch_function = get_haversine_batch_function(get_best_haversine_kernel());
+
+    batch_function(x0, y0, x1, y1, count, distances);
+}
+
+// Runs 'kernel' over 'count' pairs and compares every distance with
+// haversine_libm(). Returns the largest relative error; 'distances' is scratch
+// for 'count' results.
+static f64
+validate_haversine_batch(Haversine_Kernel kernel, const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1, mmm count,
+                         f64 *distances)
+{
+    get_haversine_batch_function(kernel)(x0, y0, x1, y1, count, distances);
+
+    f64 result = 0.0;
+    for (mmm idx = 0; idx < count; ++idx)
+    {
+        f64 expected = haversine_libm(x0[idx], y0[idx], x1[idx], y1[idx]);
+        f64 error = fabs(distances[idx] - expected);
+        if (expected != 0.0)
+            error /= expected;
+        if (error > result || error != error)
+            result = error;
+    }
+    return result;
+}
+
+//
+// Parallel sums
+//
+// @NOTE: Every task sums its own pairs in order into its own slot, and the
+// slots are added in task order at the end. Task boundaries depend only on the
+// pair count (see parallel_for), so the result is bit-identical for any number
+// of workers, one included, and with no job system at all.
+//
+
+#define HAVERSINE_PAIRS_PER_TASK    4096
+
+struct Haversine_Sum_Job
+{
+    Haversine_Pair *pairs;
+    const f64 *x0;
+    const f64 *y0;
+    const f64 *x1;
+    const f64 *y1;
+    f64 *partial_sums;
+};
+
+static void
+haversine_pairs_sum_task(void *param, u64 task_index, u64 first, u64 one_past_last)
+{
+    time_bandwidth(__func__, (one_past_last - first) * sizeof(Haversine_Pair));
+    Haversine_Sum_Job *job = (Haversine_Sum_Job *)param;
+
+    f64 sum = 0.0;
+    for (u64 idx = first; idx < one_past_last; ++idx)
+    {
+        Haversine_Pair pair = job->pairs[idx];
+        sum += haversine(pair.x0, pair.y0, pair.x1, pair.y1);
+    }
+    job->partial_sums[task_index] = sum;
+}
+
+static void
+haversine_columns_sum_task(void *param, u64 task_index, u64 first, u64 one_past_last)
+{
+    time_bandwidth(__func__, (one_past_last - first) * 4 * sizeof(f64));
+    Haversine_Sum_Job *job = (Haversine_Sum_Job *)param;
+
+    f64 distances[512];
+    f64 sum = 0.0;
+    for (u64 block = first; block < one_past_last; block += array_count(distances))
+    {
+        u64 count = one_past_last - block;
+        if (count > array_count(distances))
+            count = array_count(distances);
+
+        haversine_batch(job->x0 + block, job->y0 + block, job->x1 + block, job->y1 + block, count, distances);
+        for (u64 idx = 0; idx < count; ++idx)
+            sum += distances[idx];
+    }
+    job->partial_sums[task_index] = sum;
+}
+
+static f64
+run_haversine_sum_job(Job_System *system, Haversine_Sum_Job *job, Job_Task_Proc *task_proc, u64 pair_count, Memory_Arena *arena)
+{
+    Temporary_Memory temp = begin_temporary_memory(arena);
+    u64 task_count = get_job_task_count(pair_count, HAVERSINE_PAIRS_PER_TASK);
+    job->partial_sums = push_array(arena, f64, task_count);
+
+    parallel_for(system, pair_count, HAVERSINE_PAIRS_PER_TASK, task_proc, job);
+
+    f64 result = 0.0;
+    for (u64 task = 0; task < task_count; ++task)
+        result += job->partial_sums[task];
+
+    end_temporary_memory(temp);
+    return result;
+}
+
+// Sums distances one at a time in the same order and grouping as
+// run_haversine_sum_job(), for pairs that come in before their count is
+// known (a cursor or a stream).
+// @NOTE: Matches it bit for bit up to JOB_DEQUE_CAPACITY *
+// HAVERSINE_PAIRS_PER_TASK pairs; past that parallel_for makes its tasks
+// bigger, which depends on the final count.
+struct Haversine_Sum_Accumulator
+{
+    f64 total;
+    f64 partial;
+    u64 partial_count;
+};
+
+static void
+accumulate_haversine_sum(Haversine_Sum_Accumulator *sum, f64 distance)
+{
+    sum->partial += distance;
+    if (++sum->partial_count == HAVERSINE_PAIRS_PER_TASK)
+    {
+        sum->total += sum->partial;
+        sum->partial = 0.0;
+        sum->partial_count = 0;
+    }
+}
+
+static f64
+finish_haversine_sum(Haversine_Sum_Accumulator *sum)
+{
+    f64 result = sum->total;
+    if (sum->partial_count)
+        result += sum->partial;
+    return result;
+}
+
+// haversine() over an array of pairs, spread over the job system (or on this
+// thread without one).
+static f64
+parallel_haversine_sum_pairs(Job_System *system, Haversine_Pair *pairs, u64 pair_count, Memory_Arena *arena)
+{
+    Haversine_Sum_Job job = {};
+    job.pairs = pairs;
+    return run_haversine_sum_job(system, &job, haversine_pairs_sum_task, pair_count, arena);
+}
+
+// haversine_batch() over columns of pairs, spread over the job system (or on
+// this thread without one).
+static f64
+parallel_haversine_sum_columns(Job_System *system, const f64 *x0, const f64 *y0, const f64 *x1, const f64 *y1,
+                               u64 pair_count, Memory_Arena *arena)
+{
+    Haversine_Sum_Job job = {};
+    job.x0 = x0;
+    job.y0 = y0;
+    job.x1 = x1;
+    job.y1 = y1;
+    return run_haversine_sum_job(system, &job, haversine_columns_sum_task, pair_count, arena);
+}
@@ -0,0 +1,216 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Binary pair file. The same pairs as the json, stored the way the sum wants
+// them, so a run can map the file and start computing without parsing:
+//
+//     Haversine_Binary_Header     (padded to HAVERSINE_BINARY_ALIGNMENT)
+//     x0[pair_count]              (each column padded to the alignment)
+//     y0[pair_count]
+//     x1[pair_count]
+//     y1[pair_count]
+//
+// All values are little-endian. The checksum covers the column values only,
+// not the padding, so it's the same however the columns are laid out.
+//
+// @NOTE: haversine_generator writes coordinates the json holds exactly, so
+// its --binary output and haversine_converter's come out byte-identical.
+//
+
+#define HAVERSINE_BINARY_MAGIC      0x42565648  // "HVVB"
+#define HAVERSINE_BINARY_VERSION    1
+#define HAVERSINE_BINARY_ALIGNMENT  64
+#define HAVERSINE_BINARY_EXTENSION  ".hvb"
+
+struct Haversine_Binary_Header
+{
+    u32 magic;
+    u32 version;
+    u64 pair_count;
+    u64 column_offsets[Haversine_Field_Count];  // From the start of the file.
+    u64 checksum;
+};
+
+static u64
+align_haversine_binary_offset(u64 offset)
+{
+    return ((offset + HAVERSINE_BINARY_ALIGNMENT - 1) & ~(u64)(HAVERSINE_BINARY_ALIGNMENT - 1));
+}
+
+// 'json_filename' with its .json extension (if any) swapped for .hvb.
+static void
+get_haversine_binary_filename(const char *json_filename, char *dest, mmm dest_size)
+{
+    mmm length = strlen(json_filename);
+    if (length >= 5 && strcmp(json_filename + length - 5, ".json") == 0)
+        length -= 5;
+    snprintf(dest, dest_size, "%.*s%s", (int)length, json_filename, HAVERSINE_BINARY_EXTENSION);
+}
+
+#define FNV64_OFFSET    0xcbf29ce484222325ull
+#define FNV64_PRIME     0x100000001b3ull
+
+static u64
+fnv64_word(u64 hash, const f64 *value)
+{
+    u64 bits;
+    memcpy(&bits, value, sizeof(bits));
+    return ((hash ^ bits) * FNV64_PRIME);
+}
+
+// FNV-1a over 64-bit words rather than bytes, in four interleaved lanes so
+// the multiplies don't wait on each other. The lanes are folded together at
+// the end.
+static u64
+hash_haversine_columns(Haversine_Columns *columns)
+{
+    u64 lane0 = FNV64_OFFSET;
+    u64 lane1 = FNV64_OFFSET;
+    u64 lane2 = FNV64_OFFSET;
+    u64 lane3 = FNV64_OFFSET;
+
+    f64 *column_data[] =
+    {
+#define X(NAME) columns->NAME,
+        HAVERSINE_PAIR_FIELDS(X)
+#undef X
+    };
+    for (u32 field = 0; field < Haversine_Field_Count; ++field)
+    {
+        f64 *column = column_data[field];
+        u64 idx = 0;
+        for (; idx + 4 <= columns->count; idx += 4)
+        {
+            lane0 = fnv64_word(lane0, column + idx + 0);
+            lane1 = fnv64_word(lane1, column + idx + 1);
+            lane2 = fnv64_word(lane2, column + idx + 2);
+            lane3 = fnv64_word(lane3, column + idx + 3);
+        }
+        for (; idx < columns->count; ++idx)
+            lane0 = fnv64_word(lane0, column + idx);
+    }
+
+    u64 result = FNV64_OFFSET;
+    result = (result ^ lane0) * FNV64_PRIME;
+    result = (result ^ lane1) * FNV64_PRIME;
+    result = (result ^ lane2) * FNV64_PRIME;
+    result = (result ^ lane3) * FNV64_PRIME;
+    return result;
+}
+
+static Haversine_Binary_Header
+make_haversine_binary_header(Haversine_Columns *columns)
+{
+    Haversine_Binary_Header result = {};
+    result.magic = HAVERSINE_BINARY_MAGIC;
+    result.version = HAVERSINE_BINARY_VERSION;
+    result.pair_count = columns->count;
+
+    u64 offset = align_haversine_binary_offset(sizeof(Haversine_Binary_Header));
+    for (u32 field = 0; field < Haversine_Field_Count; ++field)
+    {
+        result.column_offsets[field] = offset;
+        offset = align_haversine_binary_offset(offset + columns->count * sizeof(f64));
+    }
+
+    result.checksum = hash_haversine_columns(columns);
+    return result;
+}
+
+static b32
+write_haversine_binary_padding(FILE *file, u64 *offset, u64 target)
+{
+    u8 zeros[HAVERSINE_BINARY_ALIGNMENT] = {};
+    assert(target - *offset <= sizeof(zeros));
+
+    b32 result = (fwrite(zeros, 1, target - *offset, file) == target - *offset);
+    *offset = target;
+    return result;
+}
+
+static b32
+write_haversine_binary(const char *filename, Haversine_Columns *columns)
+{
+    b32 result = false;
+
+    FILE *file = fopen(filename, "wb");
+    if (file)
+    {
+        Haversine_Binary_Header header = make_haversine_binary_header(columns);
+        f64 *column_data[] =
+        {
+#define X(NAME) columns->NAME,
+            HAVERSINE_PAIR_FIELDS(X)
+#undef X
+        };
+
+        result = (fwrite(&header, sizeof(header), 1, file) == 1);
+        u64 offset = sizeof(header);
+        for (u32 field = 0; result && field < Haversine_Field_Count; ++field)
+        {
+            result = write_haversine_binary_padding(file, &offset, header.column_offsets[field]);
+            result = (result && fwrite(column_data[field], sizeof(f64), columns->count, file) == columns->count);
+            offset += columns->count * sizeof(f64);
+        }
+        result = (result && write_haversine_binary_padding(file, &offset, align_haversine_binary_offset(offset)));
+
+        if (fclose(file) != 0)
+            result = false;
+    }
+    return result;
+}
+
+// Points 'columns' straight into 'file' (a mapping or any buffer aligned to
+// HAVERSINE_BINARY_ALIGNMENT). Returns false if the header doesn't describe
+// columns that fit in the file. The checksum isn't looked at; that's
+// is_haversine_binary_checksum_valid(), which has to read every value.
+static b32
+get_haversine_columns_from_binary(Buffer file, Haversine_Columns *columns, Haversine_Binary_Header *header)
+{
+    *columns = {};
+    if (file.size < sizeof(Haversine_Binary_Header))
+        return false;
+
+    memcpy(header, file.data, sizeof(*header));
+    if (header->magic != HAVERSINE_BINARY_MAGIC || header->version != HAVERSINE_BINARY_VERSION)
+        return false;
+    if (header->pair_count > file.size / sizeof(f64))
+        return false;
+
+    u64 column_size = header->pair_count * sizeof(f64);
+    for (u32 field = 0; field < Haversine_Field_Count; ++field)
+    {
+        u64 offset = header->column_offsets[field];
+        if (offset % sizeof(f64) || offset > file.size || column_size > file.size - offset)
+            return false;
+    }
+
+    f64 **column_data[] =
+    {
+#define X(NAME) &columns->NAME,
+        HAVERSINE_PAIR_FIELDS(X)
+#undef X
+    };
+    for (u32 field = 0; field < Haversine_Field_Count; ++field)
+        *column_data[field] = (f64 *)(file.data + header->column_offsets[field]);
+    columns->count = header->pair_count;
+
+    return true;
+}
+
+static b32
+is_haversine_binary_checksum_valid(Haversine_Binary_Header *header, Haversine_Columns *columns)
+{
+    return (hash_haversine_columns(columns) == header->checksum);
+}
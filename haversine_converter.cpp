@@ -0,0 +1,108 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core.h"
+#include "platform.cpp"
+#include "memory.cpp"
+#include "profiler.cpp"
+#include "haversine_shared.cpp"
+#include "haversine_binary.cpp"
+#include "job_system.cpp"
+#include "haversine_batch.cpp"
+#include "json_number.cpp"
+#include "json_parser.cpp"
+#include "json_tape.cpp"
+#include "json_direct.cpp"
+#include "json_structural.cpp"
+
+//
+// Converts a pair json into the binary column file main --binary reads.
+//
+//     haversine_converter [input.json] [output.hvb]
+//
+// The output defaults to the input with .json swapped for .hvb.
+//
+
+internal Buffer
+read_entire_file_and_null_terminate(const char *filename, Memory_Arena *arena)
+{
+    Buffer result = {};
+
+    FILE *file = fopen(filename, "rb");
+    if (file)
+    {
+        fseek(file, 0, SEEK_END);
+        mmm size = (mmm)ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        init_arena(arena, size + 1);
+        result.data = (u8 *)push_size(arena, size + 1);
+        result.size = fread(result.data, 1, size, file);
+        result.data[result.size] = 0;
+        fclose(file);
+    }
+    return result;
+}
+
+int main(int argc, char **args)
+{
+    const char *json_filename = haversine_json_filename;
+    if (argc > 1)
+        json_filename = args[1];
+
+    char binary_filename[512];
+    if (argc > 2)
+        snprintf(binary_filename, sizeof(binary_filename), "%s", args[2]);
+    else
+        get_haversine_binary_filename(json_filename, binary_filename, sizeof(binary_filename));
+
+    Memory_Arena file_arena = {};
+    Buffer json_file = read_entire_file_and_null_terminate(json_filename, &file_arena);
+    if (!json_file.data)
+    {
+        fprintf(stderr, "[ERROR]: Couldn't open %s\n", json_filename);
+        return 1;
+    }
+
+    Memory_Arena column_arena = {};
+    init_arena(&column_arena, (json_file.size / HAVERSINE_MIN_PAIR_SIZE + 1) * Haversine_Field_Count * sizeof(f64));
+
+    Haversine_Columns columns = {};
+    if (!parse_haversine_columns_direct(json_file, &column_arena, &columns))
+    {
+        // Same fallback as main --direct: valid json that isn't laid out the way the direct parser wants.
+        Memory_Arena token_arena = {};
+        Memory_Arena tape_arena = {};
+        init_arena(&token_arena, (json_file.size + 1) * sizeof(Token));
+        tokenize_structural(json_file, &token_arena);
+        init_arena(&tape_arena, ((token_arena.used / sizeof(Token)) * 2 + 1) * sizeof(u64));
+        Json_Tape tape = parse_json_tape(json_file, &token_arena, &tape_arena);
+        get_haversine_columns_from_tape(&tape, &column_arena, &columns);
+    }
+
+    if (!write_haversine_binary(binary_filename, &columns))
+    {
+        fprintf(stderr, "[ERROR]: Couldn't write %s\n", binary_filename);
+        return 1;
+    }
+
+    Haversine_Binary_Header header = make_haversine_binary_header(&columns);
+    mmm binary_size = header.column_offsets[Haversine_Field_Count - 1] + align_haversine_binary_offset(columns.count * sizeof(f64));
+    fprintf(stdout, "[OK]: Written %s (%llu pairs, %.2fmb json -> %.2fmb binary)\n", binary_filename,
+            (unsigned long long)columns.count, (f64)json_file.size / (f64)MB(1), (f64)binary_size / (f64)MB(1));
+    return 0;
+}
@@ -12,100 +12,539 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 
 #include "core.h"
+#include "platform.cpp"
+#include "memory.cpp"
+#include "profiler.cpp"
 #include "haversine_shared.cpp"
+#include "haversine_binary.cpp"
+#include "job_system.cpp"
+#include "random.cpp"
 
-internal b32
-string_equal(const char *str1, const char *str2)
+//
+// The pairs are cut into shards of GENERATOR_PAIRS_PER_SHARD. Every shard
+// draws from its own random series, seeded with (seed, shard index), and is
+// formatted into its own buffer, so its bytes don't depend on which thread
+// made it. Shards are generated a wave at a time on the job system and
+// written out in order, and their distances are added to the answer in pair
+// order, the way main's serial sum adds them: the same seed gives
+// byte-identical files for any thread count.
+//
+// @NOTE: Coordinates are drawn as fixed-point integers with
+// GENERATOR_DECIMALS digits after the point and written out exactly. Under
+// 2^53 units, units / 10^decimals is a single correctly rounded divide, which
+// is precisely the double a correctly rounded parser reads back from the text,
+// so the answer is computed on the same values main will see.
+//
+// Distributions, picked by the first argument:
+//
+//   uniform     every coordinate in [0, 180], like the original generator.
+//   cluster     points scattered around GENERATOR_CLUSTER_COUNT random
+//               centers, half the pairs within one cluster, half between two.
+//   antipodal   the second point on the far side of the globe, give or take
+//               up to a microdegree, so 'a' sits right at 1 (asin's edge).
+//   near        the second point a random 10^-1 to 10^-12 degrees from the
+//               first (or exactly on it), so the deltas are tiny.
+//   poles       latitudes piled up within 10 degrees of either pole.
+//   signed      the whole globe, lon [-180, 180] and lat [-90, 90], so half
+//               of all coordinates are negative.
+//
+// --digits N keeps N (0 to 13) digits after the point. --mixed-format also
+// gives every number its own digit count up to that and writes some of them
+// as integer-mantissa (12345e-3) or scientific (1.2345e+1) notation; the
+// values stay exact either way.
+//
+
+#define GENERATOR_PAIRS_PER_SHARD   16384
+#define GENERATOR_MAX_PAIR_SIZE     160         // A formatted pair and its separator fit in this.
+#define GENERATOR_DECIMALS          13
+#define GENERATOR_UNITS_PER_DEGREE  10000000000000ll
+#define GENERATOR_CLUSTER_COUNT     64
+
+enum Generator_Type
+{
+    Generator_Type_Invalid,
+    Generator_Type_Uniform,
+    Generator_Type_Cluster,
+    Generator_Type_Antipodal,
+    Generator_Type_Near,
+    Generator_Type_Poles,
+    Generator_Type_Signed,
+
+    Generator_Type_Count,
+};
+
+global const char *generator_type_names[Generator_Type_Count] =
+{
+    "", "uniform", "cluster", "antipodal", "near", "poles", "signed",
+};
+
+struct Generator_Cluster
+{
+    s64 x;
+    s64 y;
+    f64 radius;         // In degrees.
+};
+
+struct Generator_Shard
+{
+    u8 *text;
+    mmm text_size;
+    f64 *distances;
+    u64 pair_count;
+};
+
+struct Generator_Job
+{
+    Generator_Type type;
+    u64 seed;
+    u64 pair_count;
+    u64 first_shard;                // Of the current wave.
+    Generator_Shard *shards;
+    Haversine_Columns *columns;     // Also filled in when not 0.
+
+    Generator_Cluster clusters[GENERATOR_CLUSTER_COUNT];
+    u32 decimals;
+    b32 mixed_format;
+};
+
+static u8 *
+write_text(u8 *at, const char *text)
+{
+    while (*text)
+        *at++ = (u8)*text++;
+    return at;
+}
+
+// units / 10^decimals in plain decimal, with trailing zeros after the point
+// left off (and the point too, if nothing's left after it).
+static u8 *
+write_fixed_point(u8 *at, s64 units, u32 decimals)
+{
+    u64 magnitude = (units < 0) ? (0 - (u64)units) : (u64)units;
+    if (units < 0)
+        *at++ = '-';
+
+    // Least significant digit first, and at least one digit before the point.
+    u8 digits[24];
+    u32 digit_count = 0;
+    do
+    {
+        digits[digit_count++] = (u8)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude || digit_count <= decimals);
+
+    u32 trailing_zeros = 0;
+    while (trailing_zeros < decimals && digits[trailing_zeros] == '0')
+        ++trailing_zeros;
+
+    for (u32 idx = digit_count; idx > decimals; --idx)
+        *at++ = digits[idx - 1];
+    if (trailing_zeros < decimals)
+    {
+        *at++ = '.';
+        for (u32 idx = decimals; idx > trailing_zeros; --idx)
+            *at++ = digits[idx - 1];
+    }
+    return at;
+}
+
+// units / 10^decimals as (significant digits) e (exponent), like 1.2345e+1.
+static u8 *
+write_scientific(u8 *at, s64 units, u32 decimals)
+{
+    u64 magnitude = (units < 0) ? (0 - (u64)units) : (u64)units;
+    if (units < 0)
+        *at++ = '-';
+
+    u8 digits[24];
+    u32 digit_count = 0;
+    do
+    {
+        digits[digit_count++] = (u8)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    u32 trailing_zeros = 0;
+    while (trailing_zeros < digit_count - 1 && digits[trailing_zeros] == '0')
+        ++trailing_zeros;
+
+    *at++ = digits[digit_count - 1];
+    if (trailing_zeros < digit_count - 1)
+    {
+        *at++ = '.';
+        for (u32 idx = digit_count - 1; idx > trailing_zeros; --idx)
+            *at++ = digits[idx - 1];
+    }
+
+    s32 exponent = (s32)digit_count - 1 - (s32)decimals;
+    *at++ = 'e';
+    *at++ = (exponent < 0) ? '-' : '+';
+    u32 exponent_magnitude = (u32)((exponent < 0) ? -exponent : exponent);
+    if (exponent_magnitude >= 10)
+        *at++ = (u8)('0' + exponent_magnitude / 10);
+    *at++ = (u8)('0' + exponent_magnitude % 10);
+    return at;
+}
+
+static f64
+degrees_from_units(s64 units)
 {
-    b32 result = true;
-    while (*str1 && *str2)
+    return (f64)units / (f64)GENERATOR_UNITS_PER_DEGREE;
+}
+
+static s64
+units_from_degrees(f64 degrees)
+{
+    return (s64)llround(degrees * (f64)GENERATOR_UNITS_PER_DEGREE);
+}
+
+static s64
+clamp_latitude_units(s64 y)
+{
+    s64 limit = 90 * GENERATOR_UNITS_PER_DEGREE;
+    return (y < -limit) ? -limit : (y > limit) ? limit : y;
+}
+
+static s64
+wrap_longitude_units(s64 x)
+{
+    s64 half_turn = 180 * GENERATOR_UNITS_PER_DEGREE;
+    if (x > half_turn)
+        x -= 2 * half_turn;
+    else if (x < -half_turn)
+        x += 2 * half_turn;
+    return x;
+}
+
+static void
+generate_globe_point(Random_Series *series, s64 *x, s64 *y)
+{
+    *x = random_between(series, -180 * GENERATOR_UNITS_PER_DEGREE, 180 * GENERATOR_UNITS_PER_DEGREE);
+    *y = random_between(series, -90 * GENERATOR_UNITS_PER_DEGREE, 90 * GENERATOR_UNITS_PER_DEGREE);
+}
+
+static void
+generate_cluster_point(Generator_Cluster *cluster, Random_Series *series, s64 *x, s64 *y)
+{
+    // @NOTE: The average of three uniforms is a cheap bell curve.
+    f64 dx = cluster->radius * (random_bilateral(series) + random_bilateral(series) + random_bilateral(series)) / 3.0;
+    f64 dy = cluster->radius * (random_bilateral(series) + random_bilateral(series) + random_bilateral(series)) / 3.0;
+    *x = wrap_longitude_units(cluster->x + units_from_degrees(dx));
+    *y = clamp_latitude_units(cluster->y + units_from_degrees(dy));
+}
+
+static void
+init_generator_clusters(Generator_Job *job)
+{
+    // A stream no shard uses, so the centers don't depend on the pair count.
+    Random_Series series = seed_random_series(job->seed, ~0ull);
+    for (u32 idx = 0; idx < GENERATOR_CLUSTER_COUNT; ++idx)
+    {
+        Generator_Cluster *cluster = job->clusters + idx;
+        generate_globe_point(&series, &cluster->x, &cluster->y);
+        cluster->radius = 0.5 + 9.5 * random_unilateral(&series);
+    }
+}
+
+// Rounds to 'decimals' digits after the point, half away from zero.
+static s64
+round_units(s64 units, u32 decimals)
+{
+    s64 step = 1;
+    for (u32 idx = decimals; idx < GENERATOR_DECIMALS; ++idx)
+        step *= 10;
+
+    s64 half = (units < 0) ? -(step / 2) : (step / 2);
+    return ((units + half) / step) * step;
+}
+
+// x0, y0, x1, y1 in units.
+static void
+generate_pair_units(Generator_Job *job, Random_Series *series, s64 *units)
+{
+    switch (job->type)
     {
-        if ((*str1 != *str2) ||
-            !*str1 ||
-            !*str2)
+        case Generator_Type_Uniform:
         {
-            result = false;
-            break;
-        }
-        else
+            for (u32 idx = 0; idx < 4; ++idx)
+                units[idx] = random_between(series, 0, 180 * GENERATOR_UNITS_PER_DEGREE);
+        } break;
+
+        case Generator_Type_Cluster:
         {
-            ++str1;
-            ++str2;
-        }
+            u32 from = (u32)random_below(series, GENERATOR_CLUSTER_COUNT);
+            u32 to = (random_u64(series) & 1) ? from : (u32)random_below(series, GENERATOR_CLUSTER_COUNT);
+            generate_cluster_point(job->clusters + from, series, &units[0], &units[1]);
+            generate_cluster_point(job->clusters + to, series, &units[2], &units[3]);
+        } break;
+
+        case Generator_Type_Antipodal:
+        {
+            s64 jitter = GENERATOR_UNITS_PER_DEGREE / 1000000;
+            generate_globe_point(series, &units[0], &units[1]);
+            units[2] = wrap_longitude_units(units[0] + 180 * GENERATOR_UNITS_PER_DEGREE + random_between(series, -jitter, jitter));
+            units[3] = clamp_latitude_units(-units[1] + random_between(series, -jitter, jitter));
+        } break;
+
+        case Generator_Type_Near:
+        {
+            generate_globe_point(series, &units[0], &units[1]);
+
+            // One pair in eight is the same point twice.
+            s64 span = 0;
+            if (random_below(series, 8))
+            {
+                span = GENERATOR_UNITS_PER_DEGREE / 10;
+                for (u64 digits = random_below(series, 12); digits; --digits)
+                    span /= 10;
+            }
+            units[2] = wrap_longitude_units(units[0] + random_between(series, -span, span));
+            units[3] = clamp_latitude_units(units[1] + random_between(series, -span, span));
+        } break;
+
+        case Generator_Type_Poles:
+        {
+            for (u32 idx = 0; idx < 4; idx += 2)
+            {
+                // Cubing a uniform piles the points up at the pole itself.
+                f64 t = random_unilateral(series);
+                s64 from_pole = units_from_degrees(10.0 * t * t * t);
+                s64 y = 90 * GENERATOR_UNITS_PER_DEGREE - from_pole;
+
+                units[idx + 0] = random_between(series, -180 * GENERATOR_UNITS_PER_DEGREE, 180 * GENERATOR_UNITS_PER_DEGREE);
+                units[idx + 1] = (random_u64(series) & 1) ? y : -y;
+            }
+        } break;
+
+        case Generator_Type_Signed:
+        {
+            generate_globe_point(series, &units[0], &units[1]);
+            generate_globe_point(series, &units[2], &units[3]);
+        } break;
+
+        invalid_default_case;
     }
-    return result;
 }
 
-internal f64
-random_unilateral(void)
+// Writes one coordinate, after rounding 'units' to the digits it gets.
+static u8 *
+write_coordinate(u8 *at, Generator_Job *job, Random_Series *series, s64 *units)
 {
-    f64 result = (f64)rand() / (f64)RAND_MAX;
-    return result;
+    u32 decimals = job->decimals;
+    u64 notation = 0;
+    if (job->mixed_format)
+    {
+        decimals = (u32)random_below(series, job->decimals + 1);
+        notation = random_below(series, 8);
+    }
+
+    *units = round_units(*units, decimals);
+
+    // @NOTE: Mixed format writes 3 in 4 numbers plain, 1 in 8 as an integer
+    // mantissa times a power of ten, and 1 in 8 in scientific notation.
+    switch (notation)
+    {
+        case 6:
+        {
+            s64 mantissa = *units;
+            for (u32 idx = decimals; idx < GENERATOR_DECIMALS; ++idx)
+                mantissa /= 10;
+            at = write_fixed_point(at, mantissa, 0);
+            at = write_text(at, "e-");
+            at = write_fixed_point(at, decimals, 0);
+        } break;
+
+        case 7:
+        {
+            at = write_scientific(at, *units, GENERATOR_DECIMALS);
+        } break;
+
+        default:
+        {
+            at = write_fixed_point(at, *units, GENERATOR_DECIMALS);
+        } break;
+    }
+    return at;
 }
 
-enum Generator_Type
+static void
+generate_shard_task(void *param, u64 task_index, u64 first, u64 one_past_last)
 {
-    Generator_Type_Invalid,
-    Generator_Type_Uniform,
-    Generator_Type_Cluster,
-};
+    Generator_Job *job = (Generator_Job *)param;
+    Generator_Shard *shard = job->shards + task_index;
+    u64 shard_index = job->first_shard + task_index;
+
+    u64 first_pair = shard_index * GENERATOR_PAIRS_PER_SHARD;
+    u64 one_past_last_pair = first_pair + GENERATOR_PAIRS_PER_SHARD;
+    if (one_past_last_pair > job->pair_count)
+        one_past_last_pair = job->pair_count;
+
+    Random_Series series = seed_random_series(job->seed, shard_index);
+    u8 *at = shard->text;
+    for (u64 pair_index = first_pair; pair_index < one_past_last_pair; ++pair_index)
+    {
+        s64 units[4];
+        generate_pair_units(job, &series, units);
+
+        at = write_text(at, "  {\"x0\":");
+        at = write_coordinate(at, job, &series, &units[0]);
+        at = write_text(at, ", \"y0\":");
+        at = write_coordinate(at, job, &series, &units[1]);
+        at = write_text(at, ", \"x1\":");
+        at = write_coordinate(at, job, &series, &units[2]);
+        at = write_text(at, ", \"y1\":");
+        at = write_coordinate(at, job, &series, &units[3]);
+        at = write_text(at, "}");
+        if (pair_index != job->pair_count - 1)
+            at = write_text(at, ",\n");
+
+        f64 x0 = degrees_from_units(units[0]);
+        f64 y0 = degrees_from_units(units[1]);
+        f64 x1 = degrees_from_units(units[2]);
+        f64 y1 = degrees_from_units(units[3]);
+        shard->distances[pair_index - first_pair] = haversine(x0, y0, x1, y1);
+
+        if (job->columns)
+        {
+            job->columns->x0[pair_index] = x0;
+            job->columns->y0[pair_index] = y0;
+            job->columns->x1[pair_index] = x1;
+            job->columns->y1[pair_index] = y1;
+        }
+    }
+
+    shard->text_size = (mmm)(at - shard->text);
+    shard->pair_count = one_past_last_pair - first_pair;
+}
 
 int main(int argc, char **args)
 {
-    if (argc == 4)
+    b32 write_binary = false;
+    b32 mixed_format = false;
+    u32 decimals = GENERATOR_DECIMALS;
+    u32 thread_count = get_logical_core_count();
+    b32 arguments_valid = (argc >= 4);
+    for (int arg_index = 4; arguments_valid && arg_index < argc; ++arg_index)
     {
-        Generator_Type generator_type = Generator_Type_Invalid;
-
-        if (string_equal(args[1], "uniform"))
-            generator_type = Generator_Type_Uniform;
-        else if (string_equal(args[1], "cluster"))
-            generator_type = Generator_Type_Cluster;
+        if (string_equal(args[arg_index], "--binary"))
+            write_binary = true;
+        else if (string_equal(args[arg_index], "--threads") && arg_index + 1 < argc && atoi(args[arg_index + 1]) > 0)
+            thread_count = (u32)atoi(args[++arg_index]);
+        else if (string_equal(args[arg_index], "--digits") && arg_index + 1 < argc && atoi(args[arg_index + 1]) >= 0 && atoi(args[arg_index + 1]) <= GENERATOR_DECIMALS)
+            decimals = (u32)atoi(args[++arg_index]);
+        else if (string_equal(args[arg_index], "--mixed-format"))
+            mixed_format = true;
         else
-            invalid_code_path;
+            arguments_valid = false;
+    }
+
+    if (arguments_valid)
+    {
+        Generator_Type generator_type = Generator_Type_Invalid;
+        for (u32 type = Generator_Type_Invalid + 1; type < Generator_Type_Count; ++type)
+        {
+            if (string_equal(args[1], generator_type_names[type]))
+                generator_type = (Generator_Type)type;
+        }
 
         if (generator_type != Generator_Type_Invalid)
         {
-            u32 random_seed = atoi(args[2]);
-            u32 pair_count = atoi(args[3]);
+            u64 random_seed = (u64)atoll(args[2]);
+            u64 pair_count = (u64)atoll(args[3]);
+            u64 begin_time = read_os_timer();
+
+            Memory_Arena arena = {};
+            u32 wave_shard_count = 2 * thread_count;
+            init_arena(&arena, thread_count * (sizeof(Job_Worker) + JOB_DEQUE_CAPACITY * sizeof(u32)) +
+                               wave_shard_count * (sizeof(Generator_Shard) + GENERATOR_PAIRS_PER_SHARD * (GENERATOR_MAX_PAIR_SIZE + sizeof(f64))) + KB(64));
+
+            Job_System jobs = {};
+            init_job_system(&jobs, thread_count, false, &arena);
+
+            Generator_Job job = {};
+            job.type = generator_type;
+            job.seed = random_seed;
+            job.pair_count = pair_count;
+            job.decimals = decimals;
+            job.mixed_format = mixed_format;
+            init_generator_clusters(&job);
+            job.shards = push_array(&arena, Generator_Shard, wave_shard_count);
+            for (u32 idx = 0; idx < wave_shard_count; ++idx)
+            {
+                job.shards[idx].text = (u8 *)push_size(&arena, GENERATOR_PAIRS_PER_SHARD * GENERATOR_MAX_PAIR_SIZE);
+                job.shards[idx].distances = push_array(&arena, f64, GENERATOR_PAIRS_PER_SHARD);
+            }
 
-            srand(random_seed);
+            // With --binary the pairs are also kept as columns for the .hvb file.
+            Haversine_Columns columns = {};
+            if (write_binary)
+            {
+#define X(NAME) columns.NAME = (f64 *)malloc(pair_count * sizeof(f64));
+                HAVERSINE_PAIR_FIELDS(X)
+#undef X
+                columns.count = pair_count;
+                job.columns = &columns;
+            }
 
             f64 haversine_sum = 0.0;
+            u64 json_size = 0;
 
             FILE *haversine_json_file = fopen(haversine_json_filename, "wb");
             if (haversine_json_file)
             {
-                fprintf(haversine_json_file, "{\"pairs\":[\n");
-                if (generator_type == Generator_Type_Uniform)
+                json_size += fprintf(haversine_json_file, "{\"pairs\":[\n");
+
+                u64 shard_count = (pair_count + GENERATOR_PAIRS_PER_SHARD - 1) / GENERATOR_PAIRS_PER_SHARD;
+                for (job.first_shard = 0; job.first_shard < shard_count; job.first_shard += wave_shard_count)
                 {
-                    for (u32 pair_index = 0; pair_index < pair_count; ++pair_index)
+                    u64 wave_count = shard_count - job.first_shard;
+                    if (wave_count > wave_shard_count)
+                        wave_count = wave_shard_count;
+
+                    parallel_for(&jobs, wave_count, 1, generate_shard_task, &job);
+
+                    for (u64 idx = 0; idx < wave_count; ++idx)
                     {
-                        f64 x0 = random_unilateral() * 180.0;
-                        f64 y0 = random_unilateral() * 180.0;
-                        f64 x1 = random_unilateral() * 180.0;
-                        f64 y1 = random_unilateral() * 180.0;
-                        fprintf(haversine_json_file, "  {\"x0\":%.16f, \"y0\":%.16f, \"x1\":%.16f, \"y1\":%.16f}", x0, y0, x1, y1);
-                        if (pair_index != pair_count - 1)
-                            fprintf(haversine_json_file, ",\n");
-                        
-                        haversine_sum += haversine(x0, y0, x1, y1);
+                        Generator_Shard *shard = job.shards + idx;
+                        fwrite(shard->text, 1, shard->text_size, haversine_json_file);
+                        json_size += shard->text_size;
+                        for (u64 pair_index = 0; pair_index < shard->pair_count; ++pair_index)
+                            haversine_sum += shard->distances[pair_index];
                     }
                 }
-                else if (generator_type == Generator_Type_Cluster)
+
+                json_size += fprintf(haversine_json_file, "\n]}");
+                fclose(haversine_json_file);
+
+                f64 seconds = (f64)(read_os_timer() - begin_time) / (f64)get_os_timer_frequency();
+                fprintf(stdout, "[OK]: Written %s (%llu pairs, %.2fmb, %.3fs at %.1fmb/s on %u threads)\n", haversine_json_filename,
+                        (unsigned long long)pair_count, (f64)json_size / (f64)MB(1), seconds, (f64)json_size / ((f64)MB(1) * seconds), thread_count);
+            }
+            else
+            {
+                fprintf(stderr, "[ERROR]: Couldn't open %s\n", haversine_json_filename);
+                return 1;
+            }
+            shutdown_job_system(&jobs);
+
+            if (write_binary)
+            {
+                char haversine_binary_filename[512];
+                get_haversine_binary_filename(haversine_json_filename, haversine_binary_filename, sizeof(haversine_binary_filename));
+                if (write_haversine_binary(haversine_binary_filename, &columns))
                 {
-                    invalid_code_path;
+                    fprintf(stdout, "[OK]: Written %s\n", haversine_binary_filename);
                 }
                 else
                 {
-                    invalid_code_path;
+                    fprintf(stderr, "[ERROR]: Couldn't write %s\n", haversine_binary_filename);
+                    return 1;
                 }
-                fprintf(haversine_json_file, "\n]}");
-                fclose(haversine_json_file);
-                fprintf(stdout, "[OK]: Written %s\n", haversine_json_filename);
             }
 
             FILE *haversine_answer_file = fopen(haversine_answer_filename, "wb");
@@ -123,13 +562,14 @@ int main(int argc, char **args)
         }
         else
         {
-            fprintf(stderr, "[ERROR]: first argument must be [uniform|cluster].\n");
+            fprintf(stderr, "[ERROR]: first argument must be [uniform|cluster|antipodal|near|poles|signed].\n");
             return 1;
         }
     }
     else
     {
-        fprintf(stderr, "haversine_generator [uniform|cluster] [random_seed] [coordinate_pair_#]");
+        fprintf(stderr, "haversine_generator [uniform|cluster|antipodal|near|poles|signed] [random_seed] [coordinate_pair_#]\n"
+                        "                    [--binary] [--threads count] [--digits 0-13] [--mixed-format]");
         return 1;
     }
 }
@@ -0,0 +1,142 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// The math haversine needs, without libm, so the answers and the timings are
+// the same on every host.
+//
+//   math_sin/math_cos    x is reduced to r in [-pi/4, pi/4] with x = r + k*pi/2,
+//                        k taken from rounding x*2/pi, and pi/2 subtracted in
+//                        three parts so r keeps its precision. Both kernels
+//                        (fdlibm's coefficients) are evaluated, and k & 3 picks
+//                        one and its sign, so there's no branch on the quadrant.
+//   math_asin            x + x*R(x^2) with fdlibm's rational R for |x| <= 0.5,
+//                        and pi/2 - 2*asin(sqrt((1 - |x|)/2)) above it.
+//   math_sqrt            the sqrtsd instruction, which is correctly rounded.
+//
+// The domains haversine produces are small: sin sees half a lat/lon delta
+// (|x| <= pi), cos a latitude (|x| <= pi/2), asin and sqrt [0, 1]. The
+// reduction stays exact for |x| < 2^20 * pi/2, far past that, so there is
+// no slow path for huge arguments. math_test_main.cpp measures all four
+// against libm over those domains.
+//
+
+#include <emmintrin.h>
+
+#define TRIG_TWO_OVER_PI        6.36619772367581382433e-01
+#define TRIG_PIO2_1             1.57079632673412561417e+00   // First 33 bits of pi/2
+#define TRIG_PIO2_2             6.07710050630396597660e-11   // Next 33 bits
+#define TRIG_PIO2_2T            2.02226624879595063154e-21   // pi/2 - PIO2_1 - PIO2_2
+#define TRIG_ROUNDING_MAGIC     6755399441055744.0           // 1.5 * 2^52
+
+#define SIN_C1  -1.66666666666666324348e-01
+#define SIN_C2   8.33333333332248946124e-03
+#define SIN_C3  -1.98412698298579493134e-04
+#define SIN_C4   2.75573137070700676789e-06
+#define SIN_C5  -2.50507602534068634195e-08
+#define SIN_C6   1.58969099521155010221e-10
+
+#define COS_C1   4.16666666666666019037e-02
+#define COS_C2  -1.38888888888741095749e-03
+#define COS_C3   2.48015872894767294178e-05
+#define COS_C4  -2.75573143513906633035e-07
+#define COS_C5   2.08757232129817482790e-09
+#define COS_C6  -1.13596475577881948265e-11
+
+#define ASIN_P0  1.66666666666666657415e-01
+#define ASIN_P1 -3.25565818622400915405e-01
+#define ASIN_P2  2.01212532134862925881e-01
+#define ASIN_P3 -4.00555345006794114027e-02
+#define ASIN_P4  7.91534994289814532176e-04
+#define ASIN_P5  3.47933107596021167570e-05
+#define ASIN_Q1 -2.40339491173441421878e+00
+#define ASIN_Q2  2.02094576023350569471e+00
+#define ASIN_Q3 -6.88283971605453293030e-01
+#define ASIN_Q4  7.70381505559019352791e-02
+#define ASIN_PIO2_HI  1.57079632679489655800e+00
+#define ASIN_PIO2_LO  6.12323399573676603587e-17
+
+#define F64_SIGN_BIT  0x8000000000000000ull
+
+static f64
+f64_from_u64_bits(u64 bits)
+{
+    f64 result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static u64
+u64_bits_from_f64(f64 value)
+{
+    u64 result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+static f64
+math_sqrt(f64 x)
+{
+    return _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(x)));
+}
+
+// sin(x), or cos(x) with 'quadrant_offset' 1, since cos(x) = sin(x + pi/2).
+static f64
+math_sin_quadrant(f64 x, u64 quadrant_offset)
+{
+    // @NOTE: Adding 1.5 * 2^52 rounds x*2/pi to an integer and leaves it in
+    // the low mantissa bits, so k & 3 can be read straight out of the bits.
+    f64 t = x * TRIG_TWO_OVER_PI + TRIG_ROUNDING_MAGIC;
+    u64 quadrant = u64_bits_from_f64(t) + quadrant_offset;
+    f64 k = t - TRIG_ROUNDING_MAGIC;
+
+    f64 r = ((x - k * TRIG_PIO2_1) - k * TRIG_PIO2_2) - k * TRIG_PIO2_2T;
+    f64 z = r * r;
+
+    f64 sin_r = r + r * z * (SIN_C1 + z * (SIN_C2 + z * (SIN_C3 + z * (SIN_C4 + z * (SIN_C5 + z * SIN_C6)))));
+    f64 cos_r = 1.0 - 0.5 * z + z * z * (COS_C1 + z * (COS_C2 + z * (COS_C3 + z * (COS_C4 + z * (COS_C5 + z * COS_C6)))));
+
+    f64 result = ((quadrant & 1) ? cos_r : sin_r);
+    return f64_from_u64_bits(u64_bits_from_f64(result) ^ ((quadrant & 2) << 62));
+}
+
+static f64
+math_sin(f64 x)
+{
+    return math_sin_quadrant(x, 0);
+}
+
+static f64
+math_cos(f64 x)
+{
+    return math_sin_quadrant(x, 1);
+}
+
+// For x in [-1, 1].
+static f64
+math_asin(f64 x)
+{
+    u64 sign = (u64_bits_from_f64(x) & F64_SIGN_BIT);
+    x = f64_from_u64_bits(u64_bits_from_f64(x) ^ sign);
+
+    b32 big = (x > 0.5);
+    f64 z = (big ? (1.0 - x) * 0.5 : x * x);
+    f64 s = (big ? math_sqrt(z) : x);
+
+    f64 p = z * (ASIN_P0 + z * (ASIN_P1 + z * (ASIN_P2 + z * (ASIN_P3 + z * (ASIN_P4 + z * ASIN_P5)))));
+    f64 q = 1.0 + z * (ASIN_Q1 + z * (ASIN_Q2 + z * (ASIN_Q3 + z * ASIN_Q4)));
+    f64 r = s + s * (p / q);
+
+    f64 result = (big ? ASIN_PIO2_HI - (2.0 * r - ASIN_PIO2_LO) : r);
+    return f64_from_u64_bits(u64_bits_from_f64(result) | sign);
+}
@@ -9,6 +9,40 @@
    ======================================================================== */
 
 #include "haversine_filename.inl"
+#include "haversine_math.cpp"
+
+struct Haversine_Pair
+{
+    f64 x0, y0, x1, y1;
+};
+
+#define HAVERSINE_PAIR_FIELDS(X) \
+    X(x0)                        \
+    X(y0)                        \
+    X(x1)                        \
+    X(y1)
+
+enum Haversine_Field
+{
+#define X(NAME) Haversine_Field_##NAME,
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+
+    Haversine_Field_Count,
+};
+
+// Columns are pushed on a cache line, so the SIMD kernels' loads never split one.
+#define HAVERSINE_COLUMN_ALIGNMENT 64
+
+// Structure of arrays, one f64 column per field.
+struct Haversine_Columns
+{
+#define X(NAME) f64 *NAME;
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+
+    u64 count;
+};
 
 static double
 square(double x) 
@@ -36,6 +70,31 @@ haversine(double x0, double y0, double x1, double y1, double earth_radius = 6372
     lat1 = radians_from_degress(lat1);
     lat2 = radians_from_degress(lat2);
     
+    double a = square(math_sin(dLat/2.0)) + math_cos(lat1)*math_cos(lat2)*square(math_sin(dLon/2));
+    // @NOTE: For antipodal pairs 'a' can round to just past 1, where asin isn't defined.
+    a = (a < 1.0 ? a : 1.0);
+    double c = 2.0 * math_asin(math_sqrt(a));
+    
+    double result = earth_radius * c;
+    
+    return result;
+}
+
+// The textbook version on top of libm. haversine() is the same formula on
+// haversine_math.cpp; this one is kept to measure it against.
+static double
+haversine_libm(double x0, double y0, double x1, double y1, double earth_radius = 6372.8)
+{
+    double lat1 = y0;
+    double lat2 = y1;
+    double lon1 = x0;
+    double lon2 = x1;
+    
+    double dLat = radians_from_degress(lat2 - lat1);
+    double dLon = radians_from_degress(lon2 - lon1);
+    lat1 = radians_from_degress(lat1);
+    lat2 = radians_from_degress(lat2);
+    
     double a = square(sin(dLat/2.0)) + cos(lat1)*cos(lat2)*square(sin(dLon/2));
     double c = 2.0 * asin(sqrt(a));
     
@@ -0,0 +1,369 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Work-stealing job system. A fixed set of workers, each owning a deque of
+// task indices (Chase-Lev: the owner pushes and pops at the bottom, thieves
+// take from the top with a single CAS). The thread calling parallel_for() is
+// worker 0 and works alongside the others until the batch is done.
+//
+// parallel_for() cuts [0, item_count) into tasks of a fixed size and deals
+// them out in contiguous runs, one run per worker, so a worker starts on
+// neighbouring items and only steals once its own run is gone.
+//
+// @NOTE: The task size only depends on the item count, never on the worker
+// count. A reduction that writes one partial per task and then adds the
+// partials in task order is bit-identical however many threads ran it.
+//
+
+#define JOB_DEQUE_CAPACITY  65536       // Also the most tasks one parallel_for() makes. Power of two.
+#define JOB_MAX_WORKERS     256
+
+typedef void Job_Task_Proc(void *param, u64 task_index, u64 first, u64 one_past_last);
+
+struct Job_Deque
+{
+    volatile s64 top;
+    u8 top_padding[64 - sizeof(s64)];
+    volatile s64 bottom;
+    u8 bottom_padding[64 - sizeof(s64)];
+    u32 *tasks;
+};
+
+struct Job_Batch
+{
+    Job_Task_Proc *proc;
+    void *param;
+    u64 item_count;
+    u64 task_size;
+    volatile s64 remaining;
+};
+
+struct Job_System;
+struct Job_Worker
+{
+    Job_System *system;
+    u32 index;
+    Platform_Thread thread;
+    Job_Deque deque;
+    u64 random_state;       // For picking steal victims.
+
+    u64 tasks_run;
+    u64 tasks_stolen;
+};
+
+struct Job_System
+{
+    Job_Worker *workers;
+    u32 worker_count;
+    b32 pin_threads;
+
+    Platform_Mutex mutex;
+    Platform_Condition wake;        // A new batch is up, or it's time to quit.
+    Platform_Condition idle;        // busy_count went to 0.
+    u64 generation;
+    Job_Batch *batch;
+    u32 busy_count;                 // Workers still inside the current batch.
+    b32 quit;
+};
+
+//
+// Deque
+//
+
+// Owner only.
+static void
+job_deque_push(Job_Deque *deque, u32 task)
+{
+    s64 bottom = deque->bottom;
+    assert(bottom - atomic_load_s64(&deque->top) < JOB_DEQUE_CAPACITY);
+    deque->tasks[bottom & (JOB_DEQUE_CAPACITY - 1)] = task;
+    atomic_store_s64(&deque->bottom, bottom + 1);
+}
+
+// Owner only. Takes the most recently pushed task.
+static b32
+job_deque_pop(Job_Deque *deque, u32 *task)
+{
+    s64 bottom = deque->bottom - 1;
+    atomic_store_s64(&deque->bottom, bottom);
+    full_memory_barrier();
+    s64 top = atomic_load_s64(&deque->top);
+
+    b32 result = false;
+    if (top <= bottom)
+    {
+        *task = deque->tasks[bottom & (JOB_DEQUE_CAPACITY - 1)];
+        result = true;
+        if (top == bottom)
+        {
+            // @NOTE: Last task; a thief may be going for it too. Whoever moves top wins.
+            result = atomic_compare_exchange_s64(&deque->top, top, top + 1);
+            atomic_store_s64(&deque->bottom, bottom + 1);
+        }
+    }
+    else
+    {
+        atomic_store_s64(&deque->bottom, bottom + 1);
+    }
+    return result;
+}
+
+// Any thread. Takes the oldest task.
+static b32
+job_deque_steal(Job_Deque *deque, u32 *task)
+{
+    s64 top = atomic_load_s64(&deque->top);
+    full_memory_barrier();
+    s64 bottom = atomic_load_s64(&deque->bottom);
+
+    b32 result = false;
+    if (top < bottom)
+    {
+        u32 candidate = deque->tasks[top & (JOB_DEQUE_CAPACITY - 1)];
+        if (atomic_compare_exchange_s64(&deque->top, top, top + 1))
+        {
+            *task = candidate;
+            result = true;
+        }
+    }
+    return result;
+}
+
+//
+// Workers
+//
+
+static void
+run_job_task(Job_Batch *batch, u32 task)
+{
+    u64 first = (u64)task * batch->task_size;
+    u64 one_past_last = first + batch->task_size;
+    if (one_past_last > batch->item_count)
+        one_past_last = batch->item_count;
+
+    batch->proc(batch->param, task, first, one_past_last);
+    atomic_add_s64(&batch->remaining, -1);
+}
+
+// Works on 'batch' until every task in it has finished: its own deque first,
+// then other workers' deques picked at random.
+static void
+run_job_batch(Job_Worker *worker, Job_Batch *batch)
+{
+    Job_System *system = worker->system;
+    while (atomic_load_s64(&batch->remaining) > 0)
+    {
+        u32 task;
+        if (job_deque_pop(&worker->deque, &task))
+        {
+            run_job_task(batch, task);
+            ++worker->tasks_run;
+            continue;
+        }
+
+        b32 stole = false;
+        if (system->worker_count > 1)
+        {
+            // xorshift64
+            u64 x = worker->random_state;
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            worker->random_state = x;
+
+            u32 victim = (u32)(x % (system->worker_count - 1));
+            if (victim >= worker->index)
+                ++victim;
+
+            if (job_deque_steal(&system->workers[victim].deque, &task))
+            {
+                run_job_task(batch, task);
+                ++worker->tasks_run;
+                ++worker->tasks_stolen;
+                stole = true;
+            }
+        }
+
+        // @NOTE: Nothing left to take, but others are still finishing theirs.
+        if (!stole)
+            yield_thread();
+    }
+}
+
+static void
+job_worker_proc(void *param)
+{
+    Job_Worker *worker = (Job_Worker *)param;
+    Job_System *system = worker->system;
+
+    begin_profile_thread("job worker");
+    if (system->pin_threads)
+        pin_current_thread_to_core(worker->index % get_logical_core_count());
+
+    u64 seen_generation = 0;
+    lock_mutex(&system->mutex);
+    for (;;)
+    {
+        while (!system->quit && system->generation == seen_generation)
+            wait_condition(&system->wake, &system->mutex);
+        if (system->quit)
+            break;
+
+        seen_generation = system->generation;
+
+        // @NOTE: A worker that wakes up after the batch already finished finds
+        // it cleared and goes back to sleep without touching it.
+        Job_Batch *batch = system->batch;
+        if (batch)
+        {
+            ++system->busy_count;
+            unlock_mutex(&system->mutex);
+
+            run_job_batch(worker, batch);
+
+            lock_mutex(&system->mutex);
+            if (--system->busy_count == 0)
+                signal_condition(&system->idle);
+        }
+    }
+    unlock_mutex(&system->mutex);
+
+    release_scratch_arenas();
+}
+
+// Starts worker_count - 1 threads; the caller of parallel_for() is the last
+// worker. With 'pin_threads', worker i runs on core i (mod the core count).
+static void
+init_job_system(Job_System *system, u32 worker_count, b32 pin_threads, Memory_Arena *arena)
+{
+    if (worker_count < 1)
+        worker_count = 1;
+    if (worker_count > JOB_MAX_WORKERS)
+        worker_count = JOB_MAX_WORKERS;
+
+    *system = {};
+    system->worker_count = worker_count;
+    system->pin_threads = pin_threads;
+    // @NOTE: On a cache line, or the deque padding doesn't keep workers apart.
+    system->workers = push_array_aligned(arena, Job_Worker, worker_count, 64);
+    init_mutex(&system->mutex);
+    init_condition(&system->wake);
+    init_condition(&system->idle);
+
+    for (u32 index = 0; index < worker_count; ++index)
+    {
+        Job_Worker *worker = system->workers + index;
+        *worker = {};
+        worker->system = system;
+        worker->index = index;
+        worker->random_state = 0x9E3779B97F4A7C15ull * (index + 1);
+        worker->deque.tasks = push_array(arena, u32, JOB_DEQUE_CAPACITY);
+    }
+
+    if (pin_threads)
+        pin_current_thread_to_core(0);
+
+    for (u32 index = 1; index < worker_count; ++index)
+    {
+        if (!create_thread(&system->workers[index].thread, job_worker_proc, system->workers + index))
+            invalid_code_path;
+    }
+}
+
+static void
+shutdown_job_system(Job_System *system)
+{
+    lock_mutex(&system->mutex);
+    system->quit = true;
+    broadcast_condition(&system->wake);
+    unlock_mutex(&system->mutex);
+
+    for (u32 index = 1; index < system->worker_count; ++index)
+        join_thread(&system->workers[index].thread);
+
+    destroy_condition(&system->idle);
+    destroy_condition(&system->wake);
+    destroy_mutex(&system->mutex);
+}
+
+// Number of tasks parallel_for() will cut 'item_count' items into, for sizing
+// per-task results. 'task_size' is raised if needed to fit JOB_DEQUE_CAPACITY
+// tasks, which depends on 'item_count' alone.
+static u64
+get_job_task_size(u64 item_count, u64 task_size)
+{
+    if (task_size < 1)
+        task_size = 1;
+    u64 min_task_size = (item_count + JOB_DEQUE_CAPACITY - 1) / JOB_DEQUE_CAPACITY;
+    return (task_size > min_task_size ? task_size : min_task_size);
+}
+
+static u64
+get_job_task_count(u64 item_count, u64 task_size)
+{
+    task_size = get_job_task_size(item_count, task_size);
+    return (item_count + task_size - 1) / task_size;
+}
+
+// Calls proc(param, task_index, first, one_past_last) over [0, item_count) in
+// tasks of 'task_size' items, spread over every worker, and returns once all of
+// them are done. With no 'system' the same tasks run in order on this thread.
+static void
+parallel_for(Job_System *system, u64 item_count, u64 task_size, Job_Task_Proc *proc, void *param)
+{
+    Job_Batch batch = {};
+    batch.proc = proc;
+    batch.param = param;
+    batch.item_count = item_count;
+    batch.task_size = get_job_task_size(item_count, task_size);
+
+    u64 task_count = get_job_task_count(item_count, task_size);
+    if (!task_count)
+        return;
+    batch.remaining = (s64)task_count;
+
+    if (!system)
+    {
+        for (u64 task = 0; task < task_count; ++task)
+            run_job_task(&batch, (u32)task);
+        return;
+    }
+
+    // @NOTE: Every worker is asleep between batches, so it's safe for this
+    // thread to push into their deques. The mutex publishes them.
+    // Runs are pushed last to first, so each owner pops them in order.
+    u32 worker_count = system->worker_count;
+    for (u32 index = 0; index < worker_count; ++index)
+    {
+        u64 first = task_count * index / worker_count;
+        u64 one_past_last = task_count * (index + 1) / worker_count;
+        for (u64 task = one_past_last; task > first; --task)
+            job_deque_push(&system->workers[index].deque, (u32)(task - 1));
+    }
+
+    lock_mutex(&system->mutex);
+    system->batch = &batch;
+    ++system->generation;
+    broadcast_condition(&system->wake);
+    unlock_mutex(&system->mutex);
+
+    run_job_batch(system->workers, &batch);
+
+    // 'batch' lives on this stack, so nobody may still be looking at it.
+    lock_mutex(&system->mutex);
+    system->batch = 0;
+    while (system->busy_count)
+        wait_condition(&system->idle, &system->mutex);
+    unlock_mutex(&system->mutex);
+}
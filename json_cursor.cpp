@@ -0,0 +1,342 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// On-demand cursor over a null terminated json buffer. Nothing is parsed
+// until it's asked for: entering a container hands back its depth, which the
+// iteration functions take so they can find their place again, and any value
+// or subtree that wasn't read is skipped over the next time the cursor moves.
+//
+//     u32 object = json_cursor_enter_object(&cursor);
+//     String key;
+//     while (json_cursor_next_field(&cursor, object, &key))
+//     {
+//         if (key == "wanted")
+//             sum += json_cursor_number(&cursor);
+//     }
+//
+// Errors are sticky: once cursor.error is set every call fails, so it only
+// needs checking at the end.
+//
+
+enum Json_Cursor_Type
+{
+    Json_Cursor_Type_None,
+    Json_Cursor_Type_Object,
+    Json_Cursor_Type_Array,
+    Json_Cursor_Type_String,
+    Json_Cursor_Type_Number,
+    Json_Cursor_Type_Literal,   // true, false, null
+};
+
+struct Json_Cursor
+{
+    u8 *at;
+    u32 depth;              // Containers entered and not closed yet.
+    b32 value_pending;      // 'at' is on a value that hasn't been read or skipped.
+    b32 first;              // Nothing has been iterated in the innermost container yet.
+    b32 error;
+};
+
+static void
+init_json_cursor(Json_Cursor *cursor, Buffer source)
+{
+    *cursor = {};
+    cursor->at = source.data;
+    while (is_whitespace(*cursor->at))
+        ++cursor->at;
+    cursor->value_pending = true;
+}
+
+static void
+json_cursor_fail(Json_Cursor *cursor)
+{
+    cursor->error = true;
+    cursor->value_pending = false;
+}
+
+static void
+json_cursor_skip_whitespace(Json_Cursor *cursor)
+{
+    while (is_whitespace(*cursor->at))
+        ++cursor->at;
+}
+
+// 'at' is on the opening quote. Leaves 'at' past the closing one, or on the
+// terminator if there isn't one.
+static void
+json_cursor_skip_string(Json_Cursor *cursor)
+{
+    u8 *at = cursor->at + 1;
+    while (*at != '"')
+    {
+        if (*at == 0)
+        {
+            json_cursor_fail(cursor);
+            break;
+        }
+        at += ((*at == '\\' && at[1]) ? 2 : 1);
+    }
+    cursor->at = (cursor->error ? at : at + 1);
+}
+
+// Runs forward over raw bytes until the containers deeper than 'depth' are closed.
+static void
+json_cursor_skip_to_depth(Json_Cursor *cursor, u32 depth)
+{
+    while (!cursor->error && cursor->depth > depth)
+    {
+        switch (*cursor->at)
+        {
+            case 0:   { json_cursor_fail(cursor);                } break;
+            case '"': { json_cursor_skip_string(cursor);         } break;
+            case '{':
+            case '[': { ++cursor->depth; ++cursor->at;           } break;
+            case '}':
+            case ']': { --cursor->depth; ++cursor->at;           } break;
+            default:  { ++cursor->at;                            } break;
+        }
+    }
+    cursor->value_pending = false;
+    cursor->first = false;
+}
+
+static void
+json_cursor_skip_value(Json_Cursor *cursor)
+{
+    u8 c = *cursor->at;
+    if (c == '{' || c == '[')
+    {
+        u32 depth = cursor->depth++;
+        ++cursor->at;
+        json_cursor_skip_to_depth(cursor, depth);
+    }
+    else if (c == '"')
+    {
+        json_cursor_skip_string(cursor);
+    }
+    else
+    {
+        while (is_number_char(*cursor->at) || (*cursor->at >= 'a' && *cursor->at <= 'z'))
+            ++cursor->at;
+    }
+    cursor->value_pending = false;
+}
+
+// Gets the cursor back to the level of the container at 'depth', right after
+// its last value, skipping whatever the caller didn't read. Returns false if
+// that container is already closed.
+static b32
+json_cursor_resume(Json_Cursor *cursor, u32 depth)
+{
+    if (cursor->depth > depth)
+        json_cursor_skip_to_depth(cursor, depth);
+    else if (cursor->value_pending)
+        json_cursor_skip_value(cursor);
+
+    b32 result = (!cursor->error && cursor->depth == depth && depth != 0);
+    if (result)
+        json_cursor_skip_whitespace(cursor);
+    return result;
+}
+
+// Consumes the close of the innermost container, or the comma before the next
+// value. Returns false at the close.
+static b32
+json_cursor_advance(Json_Cursor *cursor, u8 close)
+{
+    b32 result = false;
+    if (*cursor->at == close)
+    {
+        ++cursor->at;
+        --cursor->depth;
+        cursor->first = false;
+    }
+    else if (cursor->first || *cursor->at == ',')
+    {
+        if (!cursor->first)
+            ++cursor->at;
+        cursor->first = false;
+        json_cursor_skip_whitespace(cursor);
+        result = true;
+    }
+    else
+    {
+        json_cursor_fail(cursor);
+    }
+    return result;
+}
+
+static Json_Cursor_Type
+json_cursor_type(Json_Cursor *cursor)
+{
+    Json_Cursor_Type result = Json_Cursor_Type_None;
+    if (cursor->value_pending)
+    {
+        u8 c = *cursor->at;
+        if (c == '{')
+            result = Json_Cursor_Type_Object;
+        else if (c == '[')
+            result = Json_Cursor_Type_Array;
+        else if (c == '"')
+            result = Json_Cursor_Type_String;
+        else if (c == '-' || is_number(c))
+            result = Json_Cursor_Type_Number;
+        else if (c == 't' || c == 'f' || c == 'n')
+            result = Json_Cursor_Type_Literal;
+    }
+    return result;
+}
+
+static u32
+json_cursor_enter(Json_Cursor *cursor, u8 open)
+{
+    u32 result = 0;
+    if (cursor->value_pending && *cursor->at == open)
+    {
+        ++cursor->at;
+        result = ++cursor->depth;
+        cursor->value_pending = false;
+        cursor->first = true;
+        json_cursor_skip_whitespace(cursor);
+    }
+    else
+    {
+        json_cursor_fail(cursor);
+    }
+    return result;
+}
+
+// Steps into the object the cursor is on. Returns its depth for
+// json_cursor_next_field, or 0 on error.
+static u32
+json_cursor_enter_object(Json_Cursor *cursor)
+{
+    return json_cursor_enter(cursor, '{');
+}
+
+static u32
+json_cursor_enter_array(Json_Cursor *cursor)
+{
+    return json_cursor_enter(cursor, '[');
+}
+
+// Moves to the next field of the object at 'depth' and puts the cursor on its
+// value. Returns false once the object is done.
+static b32
+json_cursor_next_field(Json_Cursor *cursor, u32 depth, String *key)
+{
+    b32 result = (json_cursor_resume(cursor, depth) && json_cursor_advance(cursor, '}'));
+    if (result)
+    {
+        if (*cursor->at != '"')
+        {
+            json_cursor_fail(cursor);
+            return false;
+        }
+
+        u8 *begin = cursor->at + 1;
+        json_cursor_skip_string(cursor);
+        key->data = begin;
+        key->size = (mmm)(cursor->at - begin - 1);
+
+        json_cursor_skip_whitespace(cursor);
+        if (*cursor->at != ':')
+        {
+            json_cursor_fail(cursor);
+            return false;
+        }
+        ++cursor->at;
+        json_cursor_skip_whitespace(cursor);
+
+        cursor->value_pending = !cursor->error;
+        result = !cursor->error;
+    }
+    return result;
+}
+
+// Moves to the next element of the array at 'depth'. Returns false once the
+// array is done.
+static b32
+json_cursor_next_element(Json_Cursor *cursor, u32 depth)
+{
+    b32 result = (json_cursor_resume(cursor, depth) && json_cursor_advance(cursor, ']'));
+    if (result)
+        cursor->value_pending = true;
+    return result;
+}
+
+// Walks the fields of the object at 'depth' until 'key' and puts the cursor on
+// its value. Fields before it are skipped unparsed.
+static b32
+json_cursor_find_field(Json_Cursor *cursor, u32 depth, const char *key)
+{
+    String field;
+    while (json_cursor_next_field(cursor, depth, &field))
+    {
+        if (field == key)
+            return true;
+    }
+    return false;
+}
+
+static f64
+json_cursor_number(Json_Cursor *cursor)
+{
+    f64 result = 0.0;
+    if (cursor->value_pending)
+    {
+        u8 *end;
+        result = parse_json_number(cursor->at, &end);
+        if (end == cursor->at)
+            json_cursor_fail(cursor);
+        cursor->at = end;
+        cursor->value_pending = false;
+    }
+    else
+    {
+        json_cursor_fail(cursor);
+    }
+    return result;
+}
+
+// The raw contents between the quotes; escapes are left as they are.
+static String
+json_cursor_string(Json_Cursor *cursor)
+{
+    String result = {};
+    if (cursor->value_pending && *cursor->at == '"')
+    {
+        u8 *begin = cursor->at + 1;
+        json_cursor_skip_string(cursor);
+        result.data = begin;
+        result.size = (mmm)(cursor->at - begin - 1);
+        cursor->value_pending = false;
+        if (cursor->error)
+            result = {};
+    }
+    else
+    {
+        json_cursor_fail(cursor);
+    }
+    return result;
+}
+
+// True if everything was read without error and only whitespace is left.
+static b32
+json_cursor_finish(Json_Cursor *cursor)
+{
+    json_cursor_resume(cursor, 0);
+    json_cursor_skip_whitespace(cursor);
+    return (!cursor->error && cursor->depth == 0 && *cursor->at == 0);
+}
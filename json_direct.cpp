@@ -0,0 +1,266 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Schema-specialized parsing. When the shape of the document is known ahead
+// of time, the bytes can be decoded straight into columns: no tokens, no DOM,
+// and every key is matched with a switch on constants packed at compile time.
+// Anything that doesn't fit the schema makes the direct parser bail, and the
+// caller falls back to the generic tokenizer + tape.
+//
+// The schema for the pair file is
+//
+//     {"pairs":[{"x0":N, "y0":N, "x1":N, "y1":N}, ...]}
+//
+// with the keys of a pair in any order, each exactly once.
+//
+
+// @NOTE: The smallest pair that fits the schema, {"x0":0,"y0":0,"x1":0,"y1":0},
+// is 29 bytes, which bounds how many pairs a file can hold.
+#define HAVERSINE_MIN_PAIR_SIZE 29
+
+// Keys of up to 7 bytes packed little-endian with the length in the top byte,
+// so a key compare is a single u64 compare and can be a case label.
+constexpr u64
+json_key_code(const char *key)
+{
+    u64 result = 0;
+    u32 length = 0;
+    while (key[length] && length < 7)
+    {
+        result |= ((u64)(u8)key[length] << (8 * length));
+        ++length;
+    }
+    return (result | ((u64)length << 56));
+}
+
+static u8 *
+direct_skip_whitespace(u8 *at)
+{
+    while (is_whitespace(*at))
+        ++at;
+    return at;
+}
+
+// Reads the quoted key at 'at' into the json_key_code packing. Returns 0 for
+// anything that can't be a schema key (escapes, longer than 7 bytes).
+static u8 *
+direct_read_key(u8 *at, u64 *code)
+{
+    if (*at != '"')
+        return 0;
+    ++at;
+
+    u64 result = 0;
+    u32 length = 0;
+    while (*at != '"')
+    {
+        if (*at == '\\' || *at == 0 || length == 7)
+            return 0;
+        result |= ((u64)*at << (8 * length));
+        ++length;
+        ++at;
+    }
+
+    *code = (result | ((u64)length << 56));
+    return (at + 1);
+}
+
+// Parses the {"pairs":[ prefix. Returns the first byte of the first element
+// (or the closing ']' of an empty array), or 0 if it doesn't match.
+static u8 *
+direct_parse_haversine_prefix(u8 *at)
+{
+    u64 code = 0;
+
+    at = direct_skip_whitespace(at);
+    if (*at++ != '{')
+        return 0;
+
+    at = direct_read_key(direct_skip_whitespace(at), &code);
+    if (!at || code != json_key_code("pairs"))
+        return 0;
+
+    at = direct_skip_whitespace(at);
+    if (*at++ != ':')
+        return 0;
+    at = direct_skip_whitespace(at);
+    if (*at++ != '[')
+        return 0;
+
+    return direct_skip_whitespace(at);
+}
+
+// Parses the pair object at 'at' into row 'index' of 'columns'. Returns the
+// byte after its closing '}', or 0 if it doesn't match.
+static u8 *
+direct_parse_haversine_pair(u8 *at, Haversine_Columns *columns, u64 index)
+{
+    if (*at++ != '{')
+        return 0;
+
+    u64 code = 0;
+    u32 seen = 0;
+    for (;;)
+    {
+        at = direct_read_key(direct_skip_whitespace(at), &code);
+        if (!at)
+            return 0;
+
+        at = direct_skip_whitespace(at);
+        if (*at++ != ':')
+            return 0;
+        at = direct_skip_whitespace(at);
+
+        u8 *number_end;
+        f64 value = parse_json_number(at, &number_end);
+        if (number_end == at)
+            return 0;
+        at = number_end;
+
+        u32 field;
+        switch (code)
+        {
+#define X(NAME) case json_key_code(#NAME): { columns->NAME[index] = value; field = Haversine_Field_##NAME; } break;
+            HAVERSINE_PAIR_FIELDS(X)
+#undef X
+            default: { return 0; } break;
+        }
+
+        if (seen & (1u << field))
+            return 0;
+        seen |= (1u << field);
+
+        at = direct_skip_whitespace(at);
+        if (*at == ',')
+            ++at;
+        else if (*at++ == '}')
+            break;
+        else
+            return 0;
+    }
+
+    if (seen != (1u << Haversine_Field_Count) - 1)
+        return 0;
+    return at;
+}
+
+static b32
+direct_parse_haversine_pairs(u8 *at, u8 *end, Haversine_Columns *columns, u64 capacity)
+{
+    at = direct_parse_haversine_prefix(at);
+    if (!at)
+        return false;
+
+    u64 count = 0;
+    if (*at == ']')
+    {
+        ++at;
+    }
+    else
+    {
+        for (;;)
+        {
+            if (count == capacity)
+                return false;
+            at = direct_parse_haversine_pair(at, columns, count);
+            if (!at)
+                return false;
+            ++count;
+
+            at = direct_skip_whitespace(at);
+            if (*at == ',')
+                at = direct_skip_whitespace(at + 1);
+            else if (*at++ == ']')
+                break;
+            else
+                return false;
+        }
+    }
+
+    at = direct_skip_whitespace(at);
+    if (*at++ != '}')
+        return false;
+    if (direct_skip_whitespace(at) != end)
+        return false;
+
+    columns->count = count;
+    return true;
+}
+
+// Decodes 'source' (null terminated) straight into columns pushed onto
+// 'arena'. Returns false, with the arena left as it was, if the input doesn't
+// match the schema.
+static b32
+parse_haversine_columns_direct(Buffer source, Memory_Arena *arena, Haversine_Columns *columns)
+{
+    time_bandwidth(__func__, source.size);
+
+    Temporary_Memory temp = begin_temporary_memory(arena);
+    u64 capacity = (source.size / HAVERSINE_MIN_PAIR_SIZE) + 1;
+
+    *columns = {};
+#define X(NAME) columns->NAME = push_array_aligned(arena, f64, capacity, HAVERSINE_COLUMN_ALIGNMENT);
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+
+    b32 result = direct_parse_haversine_pairs(source.data, source.data + source.size, columns, capacity);
+    if (!result)
+    {
+        end_temporary_memory(temp);
+        *columns = {};
+    }
+    return result;
+}
+
+// The generic route to the same columns, for input the direct parser rejected.
+static void
+get_haversine_columns_from_tape(Json_Tape *tape, Memory_Arena *arena, Haversine_Columns *columns)
+{
+    time_function();
+
+    *columns = {};
+
+    Json_Ref pairs_array = json_tape_find(json_tape_root(tape), "pairs");
+    if (!json_tape_is_valid(pairs_array) || json_tape_type(pairs_array) != Json_Tape_Type_Begin_Array)
+        invalid_code_path;
+
+    u64 capacity = json_tape_count(pairs_array);
+    if (capacity == JSON_TAPE_MAX_COUNT)
+    {
+        capacity = 0;
+        for (Json_Ref pair = json_tape_first(pairs_array); !json_tape_at_end(pair); pair = json_tape_next(pair))
+            ++capacity;
+    }
+
+#define X(NAME) columns->NAME = push_array_aligned(arena, f64, capacity, HAVERSINE_COLUMN_ALIGNMENT);
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+
+    u64 count = 0;
+    for (Json_Ref pair = json_tape_first(pairs_array); !json_tape_at_end(pair); pair = json_tape_next(pair))
+    {
+#define X(NAME)                                                                         \
+        {                                                                               \
+            Json_Ref value = json_tape_find(pair, #NAME);                               \
+            if (!json_tape_is_valid(value) || json_tape_type(value) != Json_Tape_Type_Number) \
+                invalid_code_path;                                                      \
+            columns->NAME[count] = json_tape_number(value);                             \
+        }
+        HAVERSINE_PAIR_FIELDS(X)
+#undef X
+        ++count;
+    }
+
+    columns->count = count;
+}
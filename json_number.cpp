@@ -0,0 +1,385 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Correctly rounded parsing of json numbers:
+//
+//     -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+//
+// The digits are gathered into a u64 mantissa w and a power of ten q, eight
+// at a time where possible. Small exact cases (w <= 2^53, |q| <= 22) are a
+// single f64 multiply or divide. Everything else goes through the
+// Eisel-Lemire conversion, which multiplies w by a 128-bit approximation of
+// 5^q and rounds straight to the nearest double. The few inputs it can't
+// decide (more than 19 significant digits sitting right on a rounding
+// boundary, subnormals) fall back to strtod.
+//
+
+#include "json_number_table.inl"
+
+#define JSON_NUMBER_SMALLEST_POWER_OF_TEN   -342
+#define JSON_NUMBER_LARGEST_POWER_OF_TEN    308
+#define JSON_NUMBER_MAX_DIGITS              19
+
+#define F64_MANTISSA_BITS                   52
+#define F64_MINIMUM_EXPONENT                -1023
+#define F64_INFINITE_POWER                  0x7FF
+
+struct U128
+{
+    u64 lo;
+    u64 hi;
+};
+
+static U128
+multiply_u64(u64 a, u64 b)
+{
+    U128 result;
+#ifdef _MSC_VER
+    result.lo = _umul128(a, b, &result.hi);
+#else
+    unsigned __int128 product = (unsigned __int128)a * b;
+    result.lo = (u64)product;
+    result.hi = (u64)(product >> 64);
+#endif
+    return result;
+}
+
+static b32
+is_digit(u8 c)
+{
+    return ((u8)(c - '0') < 10);
+}
+
+// @NOTE: Numbers are parsed out of null terminated buffers with no end
+// pointer, so an eight byte load may run past the terminator. That's harmless
+// as long as it stays inside the page 'at' lives in.
+static b32
+can_load_eight_bytes(u8 *at)
+{
+    return (((umm)at & 4095) <= 4096 - 8);
+}
+
+static u64
+load_eight_bytes(u8 *at)
+{
+    u64 result;
+    memcpy(&result, at, sizeof(result));
+    return result;
+}
+
+// Eight ascii digits (first digit in the lowest byte) to their value, by
+// combining neighbouring pairs, then pairs of pairs, then the two halves.
+static u32
+parse_eight_digits(u64 value)
+{
+    u64 mask = 0x000000FF000000FFull;
+    u64 mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+    u64 mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+    value -= 0x3030303030303030ull;
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+    return (u32)value;
+}
+
+// High bit set in every byte of 'value' that isn't an ascii digit. A carry out
+// of a non-digit byte can spoil the bytes above it, which is fine because only
+// the first non-digit is ever looked at.
+static u64
+non_digit_bytes(u64 value)
+{
+    u64 x = ((value & 0xF0F0F0F0F0F0F0F0ull) |
+             (((value + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ^ 0x3333333333333333ull;
+    return ((((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x) & 0x8080808080808080ull);
+}
+
+// @NOTE: A run of digits is consumed eight at a time, and the last partial
+// chunk is shifted up and padded with '0's so it goes through the same
+// conversion. The length of a run (1 to 3 integer digits for coordinates)
+// is unpredictable, and a branch per digit would mispredict on it.
+static u8 *
+accumulate_digits(u8 *at, u64 *mantissa)
+{
+    static const u64 powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+    u64 w = *mantissa;
+    while (can_load_eight_bytes(at))
+    {
+        u64 chunk = load_eight_bytes(at);
+        u64 non_digit = non_digit_bytes(chunk);
+        if (!non_digit)
+        {
+            w = w * 100000000 + parse_eight_digits(chunk);
+            at += 8;
+            continue;
+        }
+
+        u32 digit_count = (count_trailing_zeros(non_digit) >> 3);
+        if (digit_count)
+        {
+            u32 shift = 8 * (8 - digit_count);
+            u64 padded = (chunk << shift) | (0x3030303030303030ull >> (64 - shift));
+            w = w * powers_of_ten[digit_count] + parse_eight_digits(padded);
+            at += digit_count;
+        }
+        *mantissa = w;
+        return at;
+    }
+
+    while (is_digit(*at))
+    {
+        w = w * 10 + (u64)(*at - '0');
+        ++at;
+    }
+    *mantissa = w;
+    return at;
+}
+
+struct Json_Number_Parts
+{
+    b32 negative;
+    b32 truncated;      // More than JSON_NUMBER_MAX_DIGITS significant digits; w is rounded down.
+    u64 w;
+    s64 q;              // value = w * 10^q
+};
+
+// With more than 19 significant digits w has wrapped, so it's rebuilt from the
+// first 19 and q is adjusted for the ones that were dropped.
+static void
+truncate_json_number(u8 *digits, u8 *digits_end, Json_Number_Parts *parts, s64 explicit_exponent)
+{
+    u64 w = 0;
+    s64 q = explicit_exponent;
+    u32 taken = 0;
+    b32 in_fraction = false;
+    for (u8 *at = digits; at < digits_end; ++at)
+    {
+        if (*at == '.')
+        {
+            in_fraction = true;
+        }
+        else if (taken < JSON_NUMBER_MAX_DIGITS)
+        {
+            if (taken || *at != '0')
+            {
+                w = w * 10 + (u64)(*at - '0');
+                ++taken;
+            }
+            if (in_fraction)
+                --q;
+        }
+        else
+        {
+            parts->truncated = true;
+            if (!in_fraction)
+                ++q;
+        }
+    }
+    parts->w = w;
+    parts->q = q;
+}
+
+// Returns the end of the number, or 'at' itself if it isn't a valid one.
+static u8 *
+scan_json_number(u8 *at, Json_Number_Parts *parts)
+{
+    u8 *start = at;
+    *parts = {};
+
+    if (*at == '-')
+    {
+        parts->negative = true;
+        ++at;
+    }
+
+    u8 *digits = at;
+    if (!is_digit(*at))
+        return start;
+
+    u64 w = 0;
+    if (*at == '0')
+        ++at;
+    else
+        at = accumulate_digits(at, &w);
+    s64 digit_count = (at - digits);
+
+    s64 q = 0;
+    if (*at == '.')
+    {
+        u8 *fraction = ++at;
+        at = accumulate_digits(at, &w);
+        if (at == fraction)
+            return start;
+        q = -(s64)(at - fraction);
+        digit_count += (at - fraction);
+    }
+    u8 *digits_end = at;
+
+    s64 explicit_exponent = 0;
+    if (*at == 'e' || *at == 'E')
+    {
+        ++at;
+        b32 negative_exponent = (*at == '-');
+        if (*at == '-' || *at == '+')
+            ++at;
+        if (!is_digit(*at))
+            return start;
+        while (is_digit(*at))
+        {
+            // @NOTE: Anything this large is already 0 or infinity; stop growing so it can't overflow.
+            if (explicit_exponent < 0x10000)
+                explicit_exponent = explicit_exponent * 10 + (*at - '0');
+            ++at;
+        }
+        if (negative_exponent)
+            explicit_exponent = -explicit_exponent;
+    }
+
+    parts->w = w;
+    parts->q = q + explicit_exponent;
+    if (digit_count > JSON_NUMBER_MAX_DIGITS)
+        truncate_json_number(digits, digits_end, parts, explicit_exponent);
+
+    return at;
+}
+
+// Binary exponent of 10^q, i.e. floor(log2(10^q)) + 63, without a loop.
+static s32
+power_of_ten_to_binary_exponent(s32 q)
+{
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+// Eisel-Lemire. Writes the bits of w * 10^q rounded to nearest-even (sign not
+// included) and returns true, or returns false for the subnormal range, which
+// is left to the slow path.
+static b32
+compute_f64_bits(u64 w, s64 q, u64 *bits)
+{
+    if (w == 0 || q < JSON_NUMBER_SMALLEST_POWER_OF_TEN)
+    {
+        *bits = 0;
+        return true;
+    }
+    if (q > JSON_NUMBER_LARGEST_POWER_OF_TEN)
+    {
+        *bits = ((u64)F64_INFINITE_POWER << F64_MANTISSA_BITS);
+        return true;
+    }
+
+    u32 leading_zeros = count_leading_zeros(w);
+    w <<= leading_zeros;
+
+    // @NOTE: Only the top 55 bits of the product matter. The second half of
+    // the 128-bit power is needed only when the low bits of the first product
+    // are all ones and a carry from below could still reach them.
+    u32 index = 2 * (u32)(q - JSON_NUMBER_SMALLEST_POWER_OF_TEN);
+    U128 product = multiply_u64(w, g_power_of_five_128[index]);
+    u64 precision_mask = (0xFFFFFFFFFFFFFFFFull >> (F64_MANTISSA_BITS + 3));
+    if ((product.hi & precision_mask) == precision_mask)
+    {
+        U128 second = multiply_u64(w, g_power_of_five_128[index + 1]);
+        product.lo += second.hi;
+        if (second.hi > product.lo)
+            ++product.hi;
+    }
+
+    u32 upper_bit = (u32)(product.hi >> 63);
+    u32 shift = upper_bit + 64 - F64_MANTISSA_BITS - 3;
+    u64 mantissa = (product.hi >> shift);
+    s32 power2 = power_of_ten_to_binary_exponent((s32)q) + (s32)upper_bit - (s32)leading_zeros - F64_MINIMUM_EXPONENT;
+
+    if (power2 <= 0)
+        return false;
+
+    // @NOTE: Exactly halfway between two doubles can only happen for small q,
+    // where the product is exact. Round to even by not rounding up.
+    if ((product.lo <= 1) && (q >= -4) && (q <= 23) && ((mantissa & 3) == 1))
+    {
+        if ((mantissa << shift) == product.hi)
+            mantissa &= ~1ull;
+    }
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= (2ull << F64_MANTISSA_BITS))
+    {
+        mantissa = (1ull << F64_MANTISSA_BITS);
+        ++power2;
+    }
+    mantissa &= ~(1ull << F64_MANTISSA_BITS);
+
+    if (power2 >= F64_INFINITE_POWER)
+    {
+        power2 = F64_INFINITE_POWER;
+        mantissa = 0;
+    }
+
+    *bits = (mantissa | ((u64)power2 << F64_MANTISSA_BITS));
+    return true;
+}
+
+static f64
+f64_from_bits(u64 bits)
+{
+    f64 result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Parses the number at 'at'. On success *end is set past it, otherwise *end
+// is left at 'at' and 0 is returned.
+static f64
+parse_json_number(u8 *at, u8 **end)
+{
+    static const f64 exact_powers_of_ten[] =
+    {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    Json_Number_Parts parts;
+    *end = scan_json_number(at, &parts);
+    if (*end == at)
+        return 0.0;
+
+    f64 result;
+    u64 bits;
+    if (!parts.truncated && parts.w <= (1ull << 53) && parts.q >= -22 && parts.q <= 22)
+    {
+        // Both w and 10^|q| are exact doubles, so one correctly rounded operation is enough.
+        result = (f64)parts.w;
+        if (parts.q < 0)
+            result /= exact_powers_of_ten[-parts.q];
+        else
+            result *= exact_powers_of_ten[parts.q];
+        if (parts.negative)
+            result = -result;
+    }
+    else if (compute_f64_bits(parts.w, parts.q, &bits))
+    {
+        // @NOTE: A truncated w lies just below the real value. If w and w+1
+        // round to the same double, so does everything in between.
+        u64 upper_bits = bits;
+        if (parts.truncated && (!compute_f64_bits(parts.w + 1, parts.q, &upper_bits) || upper_bits != bits))
+            result = strtod((char *)at, 0);
+        else
+            result = f64_from_bits(bits | ((u64)parts.negative << 63));
+    }
+    else
+    {
+        result = strtod((char *)at, 0);
+    }
+
+    return result;
+}
@@ -0,0 +1,243 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Parallel parsing of the pair file. The body of the "pairs" array is cut
+// into one byte range per worker, every range is decoded with the direct
+// parser into columns of its own, and the columns are stitched together in
+// range order.
+//
+// A range owns the elements that *start* inside it, so its first element is
+// the first '{' at or after the cut whose previous non-whitespace byte is a
+// ','. That's only a guess: the cut can land inside a string, and a key like
+// "a,{" looks exactly like an element boundary from there.
+//
+// @NOTE: Guesses are checked instead of avoided. The parser of a range keeps
+// going until the first element that starts at or past the end of its range,
+// and that's where the next range really starts. Range 0 starts at the true
+// first element, so going through the ranges in order, a range whose guess
+// doesn't match where the previous one stopped (or that failed to parse from
+// its guess) is parsed again from the right place. Bad guesses cost a serial
+// re-parse of one range; the result is always what the serial parser gives.
+//
+
+#define JSON_PARALLEL_MIN_RANGE_SIZE KB(64)
+
+struct Json_Parallel_Range
+{
+    u8 *range_begin;
+    u8 *range_end;
+
+    u8 *first;                  // The element this range started parsing at.
+    u8 *stop;                   // The first element at or past range_end, or the closing ']'.
+    b32 parsed;
+
+    Memory_Arena arena;
+    Haversine_Columns columns;
+    u64 capacity;
+    u64 offset;                 // Where the columns go in the stitched result.
+};
+
+struct Json_Parallel_Parse
+{
+    Json_Parallel_Range *ranges;
+    u8 *array_end;
+    Haversine_Columns *columns;
+};
+
+// The first '{' in [at, array_end) whose previous non-whitespace byte is a ','.
+static u8 *
+guess_json_element_start(u8 *at, u8 *array_end)
+{
+    for (; at < array_end; ++at)
+    {
+        if (*at == '{')
+        {
+            u8 *before = at - 1;
+            while (is_whitespace(*before))
+                --before;
+            if (*before == ',')
+                break;
+        }
+    }
+    return at;
+}
+
+// Parses the elements that start in [first, range->range_end).
+static b32
+parse_json_parallel_range(Json_Parallel_Range *range, u8 *first, u8 *array_end)
+{
+    reset_arena(&range->arena);
+    range->first = first;
+    range->parsed = false;
+
+    Haversine_Columns *columns = &range->columns;
+    *columns = {};
+#define X(NAME) columns->NAME = push_array(&range->arena, f64, range->capacity);
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+    if (!columns->y1)       // The last push fails if any of them did.
+        return false;
+
+    u8 *at = first;
+    u64 count = 0;
+    while (at < range->range_end && at != array_end)
+    {
+        if (count == range->capacity)
+            return false;
+        at = direct_parse_haversine_pair(at, columns, count);
+        if (!at)
+            return false;
+        ++count;
+
+        at = direct_skip_whitespace(at);
+        if (*at == ',')
+        {
+            at = direct_skip_whitespace(at + 1);
+            if (at == array_end)
+                return false;
+        }
+        else if (at != array_end)
+        {
+            return false;
+        }
+    }
+
+    columns->count = count;
+    range->stop = at;
+    range->parsed = true;
+    return true;
+}
+
+static void
+parse_json_parallel_range_task(void *param, u64 task_index, u64 first, u64 one_past_last)
+{
+    Json_Parallel_Parse *parse = (Json_Parallel_Parse *)param;
+    Json_Parallel_Range *range = parse->ranges + task_index;
+    time_bandwidth(__func__, (mmm)(range->range_end - range->range_begin));
+
+    u8 *guess = range->range_begin;
+    if (task_index)
+        guess = guess_json_element_start(range->range_begin, parse->array_end);
+    parse_json_parallel_range(range, guess, parse->array_end);
+}
+
+static void
+copy_json_parallel_range_task(void *param, u64 task_index, u64 first, u64 one_past_last)
+{
+    Json_Parallel_Parse *parse = (Json_Parallel_Parse *)param;
+    Json_Parallel_Range *range = parse->ranges + task_index;
+    time_bandwidth(__func__, range->columns.count * Haversine_Field_Count * sizeof(f64));
+
+#define X(NAME) memcpy(parse->columns->NAME + range->offset, range->columns.NAME, range->columns.count * sizeof(f64));
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+}
+
+// Same result as parse_haversine_columns_direct(), decoded on every worker of
+// 'jobs'. Only the result goes on 'arena': the range table and the per-range
+// columns are on this thread's scratch arena, which the workers write into
+// but never push onto.
+static b32
+parse_haversine_columns_parallel(Job_System *jobs, Buffer source, Memory_Arena *arena, Haversine_Columns *columns)
+{
+    // @NOTE: A single range would only add the copy into the result.
+    if (jobs->worker_count < 2 || source.size < 2 * JSON_PARALLEL_MIN_RANGE_SIZE)
+        return parse_haversine_columns_direct(source, arena, columns);
+
+    time_bandwidth(__func__, source.size);
+
+    Temporary_Memory temp = begin_temporary_memory(arena);
+    u64 capacity = (source.size / HAVERSINE_MIN_PAIR_SIZE) + 1;
+
+    *columns = {};
+#define X(NAME) columns->NAME = push_array_aligned(arena, f64, capacity, HAVERSINE_COLUMN_ALIGNMENT);
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+
+    // {"pairs":[ ... ] }: the array body is everything between the prefix and
+    // the ']' before the final '}'.
+    u8 *array_begin = direct_parse_haversine_prefix(source.data);
+    u8 *array_end = source.data + source.size;
+    if (array_begin)
+    {
+        do { --array_end; } while (array_end > array_begin && is_whitespace(*array_end));
+        if (*array_end == '}')
+        {
+            do { --array_end; } while (array_end > array_begin && is_whitespace(*array_end));
+        }
+        if (array_end < array_begin || *array_end != ']')
+            array_begin = 0;
+    }
+
+    b32 result = (array_begin != 0);
+    if (result)
+    {
+        Temporary_Memory scratch = begin_temporary_memory(get_scratch_arena(arena));
+
+        mmm body_size = (mmm)(array_end - array_begin);
+        u32 range_count = jobs->worker_count;
+        if (body_size / range_count < JSON_PARALLEL_MIN_RANGE_SIZE)
+            range_count = (u32)(body_size / JSON_PARALLEL_MIN_RANGE_SIZE) + 1;
+
+        Json_Parallel_Parse parse = {};
+        parse.ranges = push_array(scratch.arena, Json_Parallel_Range, range_count);
+        parse.array_end = array_end;
+        parse.columns = columns;
+
+        for (u32 index = 0; index < range_count; ++index)
+        {
+            Json_Parallel_Range *range = parse.ranges + index;
+            *range = {};
+            range->range_begin = array_begin + body_size * index / range_count;
+            range->range_end = array_begin + body_size * (index + 1) / range_count;
+
+            // @NOTE: Elements start at least HAVERSINE_MIN_PAIR_SIZE + 1 bytes apart.
+            range->capacity = (mmm)(range->range_end - range->range_begin) / HAVERSINE_MIN_PAIR_SIZE + 1;
+            mmm range_size = range->capacity * Haversine_Field_Count * sizeof(f64);
+            range->arena.base = (u8 *)push_size_aligned(scratch.arena, range_size, HAVERSINE_COLUMN_ALIGNMENT);
+            range->arena.size = range_size;
+        }
+
+        parallel_for(jobs, range_count, 1, parse_json_parallel_range_task, &parse);
+
+        u8 *expected = array_begin;
+        u64 count = 0;
+        for (u32 index = 0; result && index < range_count; ++index)
+        {
+            Json_Parallel_Range *range = parse.ranges + index;
+            if (!range->parsed || range->first != expected)
+                result = parse_json_parallel_range(range, expected, array_end);
+
+            range->offset = count;
+            count += range->columns.count;
+            expected = range->stop;
+        }
+
+        result = (result && expected == array_end);
+        if (result)
+        {
+            parallel_for(jobs, range_count, 1, copy_json_parallel_range_task, &parse);
+            columns->count = count;
+        }
+
+        end_temporary_memory(scratch);
+    }
+
+    if (!result)
+    {
+        end_temporary_memory(temp);
+        *columns = {};
+    }
+    return result;
+}
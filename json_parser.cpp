@@ -25,152 +25,108 @@ enum Token_Type
     Token_Type_Number,
 };
 
+// @NOTE: A token is a view of source[offset, offset + size) rather than a copy,
+// which keeps it at 8 bytes and means punctuation needs no storage. For
+// strings the view excludes the quotes. Numbers are converted by the parser.
 struct Token
 {
-    Token_Type type;
-    Buffer buffer;
+    u32 offset;
+    u32 type : 8;
+    u32 size : 24;
 };
 
-typedef Stream Tokenizer;
+struct Tokenizer
+{
+    u8 *base;
+    u8 *at;
+};
 
 static b32
 is_whitespace(char c)
 {
-    time_function();
     return (c == ' '  || c == '\n' || c == '\r' || c == '\t');
 }
 
 static b32
 is_number(char c)
 {
-    time_function();
     return (c >= '0' && c <= '9');
 }
 
-static Buffer
-push_char(char c, Memory_Arena *arena)
+static b32
+is_number_char(u8 c)
 {
-    time_function();
-
-    Buffer result = {};
-
-    char *x = push_struct(arena, char);
-    *x = c;
-
-    result.data = (u8 *)x;
-    result.size = 1;
-    return result;
+    return ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E');
 }
 
-static Buffer
-push_string(char *begin, char *end, Memory_Arena *arena)
+static f64
+json_get_number_from_stream(Stream *stream)
 {
-    time_function();
-
-    Buffer result = {};
-
-    mmm length = (end - begin);
-    char *data = (char *)push_size(arena, length);
-    for (u32 i = 0; i < length; ++i)
-        data[i] = begin[i];
-
-    result.data = (u8 *)data;
-    result.size = length;
+    u8 *end;
+    f64 result = parse_json_number(stream->at, &end);
+    stream->at = end;
     return result;
 }
 
-static f64
-json_get_number_from_stream(Stream *stream)
+// The closing quote of the string whose opening quote is at 'at'. An escape
+// is skipped along with the byte it escapes, so an escaped quote doesn't end
+// the string.
+static u8 *
+find_string_close(u8 *at)
 {
-    f64 n = 0.0;
-    while (is_number(*stream->at))
-    {
-        n = n * 10.0 + (f64)(*stream->at - '0');
-        ++stream->at;
-    }
-
-    if (*stream->at == '.')
-        ++stream->at;
+    ++at;
+    while (*at != '"')
+        at += (*at == '\\') ? 2 : 1;
+    return at;
+}
 
-    f64 m = 0.1;
-    while (is_number(*stream->at))
-    {
-        n += m * (f64)(*stream->at - '0');
-        ++stream->at;
-        m /= 10.0;
-    }
+// Strings go through here rather than push_token(): 'tokenizer->at' is on the
+// opening quote and 'close' is the closing one.
+static void
+push_string_token(Tokenizer *tokenizer, u8 *close, Memory_Arena *token_arena)
+{
+    u8 *start = tokenizer->at + 1;
+    mmm size = (mmm)(close - start);
+    assert(size < (1 << 24));
 
-    return n;
+    Token *tk = push_struct(token_arena, Token);
+    tk->type = Token_Type_String;
+    tk->offset = (u32)(start - tokenizer->base);
+    tk->size = (u32)size;
+    tokenizer->at = close + 1;
 }
 
 static void
-push_token(Tokenizer *tokenizer, Token_Type type,
-           Memory_Arena *token_arena, Memory_Arena *literal_arena)
+push_token(Tokenizer *tokenizer, Token_Type type, Memory_Arena *token_arena)
 {
-    time_function();
-
     Token *tk = push_struct(token_arena, Token);
     tk->type = type;
+    tk->offset = (u32)(tokenizer->at - tokenizer->base);
+    tk->size = 0;
     switch (type)
     {
         case Token_Type_EOF:
         case Token_Type_Invalid:
         {
-            tk->buffer = Buffer{};
-        } break;;
-
-        case Token_Type_Left_Brace:
-        {
-            tk->buffer = push_char('{', literal_arena);
-            ++tokenizer->at;
         } break;
 
+        case Token_Type_Left_Brace:
         case Token_Type_Right_Brace:
-        {
-            tk->buffer = push_char('}', literal_arena);
-            ++tokenizer->at;
-        } break;
-
         case Token_Type_Left_Bracket:
-        {
-            tk->buffer = push_char('[', literal_arena);
-            ++tokenizer->at;
-        } break;
-
         case Token_Type_Right_Bracket:
-        {
-            tk->buffer = push_char(']', literal_arena);
-            ++tokenizer->at;
-        } break;
-
         case Token_Type_Comma:
-        {
-            tk->buffer = push_char(',', literal_arena);
-            ++tokenizer->at;
-        } break;
-
         case Token_Type_Colon:
         {
-            tk->buffer = push_char(':', literal_arena);
-            ++tokenizer->at;
-        } break;
-
-        case Token_Type_String:
-        {
-            char* start = (char *)++tokenizer->at;
-            while (*tokenizer->at != '"')
-                ++tokenizer->at;
-            char *end = (char *)tokenizer->at;
-            tk->buffer = push_string(start, end, literal_arena);
+            tk->size = 1;
             ++tokenizer->at;
         } break;
 
         case Token_Type_Number:
         {
-            tk->buffer.data = (u8 *)push_struct(literal_arena, f64);
-            tk->buffer.size = sizeof(f64);
-
-            *((f64 *)tk->buffer.data) = json_get_number_from_stream(tokenizer);
+            u8 *start = tokenizer->at;
+            while (is_number_char(*tokenizer->at))
+                ++tokenizer->at;
+            tk->size = (u32)(tokenizer->at - start);
         } break;
 
         invalid_default_case;
@@ -178,11 +134,14 @@ push_token(Tokenizer *tokenizer, Token_Type type,
 }
 
 static void
-tokenize(Buffer buffer, Memory_Arena *token_arena, Memory_Arena *literal_arena)
+tokenize(Buffer buffer, Memory_Arena *token_arena)
 {
-    time_function();
+    time_bandwidth(__func__, buffer.size);
+
+    assert(buffer.size < ((mmm)1 << 32));
 
     Tokenizer tk = {};
+    tk.base = buffer.data;
     tk.at = buffer.data;
 
     for (;;)
@@ -191,38 +150,38 @@ tokenize(Buffer buffer, Memory_Arena *token_arena, Memory_Arena *literal_arena)
         {
             case 0: 
             {
-                push_token(&tk, Token_Type_EOF, token_arena, literal_arena);
+                push_token(&tk, Token_Type_EOF, token_arena);
                 return;
             } break;
 
             case '{':
             {
-                push_token(&tk, Token_Type_Left_Brace, token_arena, literal_arena);
+                push_token(&tk, Token_Type_Left_Brace, token_arena);
             } break;
 
             case '}':
             {
-                push_token(&tk, Token_Type_Right_Brace, token_arena, literal_arena);
+                push_token(&tk, Token_Type_Right_Brace, token_arena);
             } break;
 
             case '[':
             {
-                push_token(&tk, Token_Type_Left_Bracket, token_arena, literal_arena);
+                push_token(&tk, Token_Type_Left_Bracket, token_arena);
             } break;
 
             case ']':
             {
-                push_token(&tk, Token_Type_Right_Bracket, token_arena, literal_arena);
+                push_token(&tk, Token_Type_Right_Bracket, token_arena);
             } break;
 
             case ',':
             {
-                push_token(&tk, Token_Type_Comma, token_arena, literal_arena);
+                push_token(&tk, Token_Type_Comma, token_arena);
             } break;
 
             case ':':
             {
-                push_token(&tk, Token_Type_Colon, token_arena, literal_arena);
+                push_token(&tk, Token_Type_Colon, token_arena);
             } break;
 
             default:
@@ -233,11 +192,11 @@ tokenize(Buffer buffer, Memory_Arena *token_arena, Memory_Arena *literal_arena)
                 }
                 else if (*tk.at == '"')
                 {
-                    push_token(&tk, Token_Type_String, token_arena, literal_arena);
+                    push_string_token(&tk, find_string_close(tk.at), token_arena);
                 }
-                else if (is_number(*tk.at))
+                else if (is_number(*tk.at) || *tk.at == '-')
                 {
-                    push_token(&tk, Token_Type_Number, token_arena, literal_arena);
+                    push_token(&tk, Token_Type_Number, token_arena);
                 }
                 else
                 {
@@ -249,7 +208,7 @@ tokenize(Buffer buffer, Memory_Arena *token_arena, Memory_Arena *literal_arena)
 }
 
 static void
-DEBUG_print_tokens(Memory_Arena *arena)
+DEBUG_print_tokens(Buffer source, Memory_Arena *arena)
 {
     Token *tk = (Token *)arena->base;
     for (;;)
@@ -272,12 +231,9 @@ DEBUG_print_tokens(Memory_Arena *arena)
             case Token_Type_Comma:
             case Token_Type_Colon:
             case Token_Type_String:
-            {
-                printf("%.*s\n", (s32)tk->buffer.size, tk->buffer.data);
-            } break;
             case Token_Type_Number:
             {
-                printf("%.16f\n", *(f64 *)tk->buffer.data);
+                printf("%.*s\n", (s32)tk->size, source.data + tk->offset);
             } break;
         }
 
@@ -285,9 +241,109 @@ DEBUG_print_tokens(Memory_Arena *arena)
     }
 }
 
+//
+// Keys are interned while parsing: every distinct key is stored once in a
+// Json_Key_Table and objects only hold its id, so comparing keys is comparing
+// integers. Ids start at 1; 0 means 'not a key in this document'.
+//
+
+#define JSON_KEY_TABLE_INITIAL_SLOTS    64
+#define JSON_OBJECT_INDEX_THRESHOLD     16
+
+struct Json_Key_Table
+{
+    u32 *slots;         // Open addressing, holds ids. Power of two in size.
+    u32 slot_mask;
+    String *strings;    // Indexed by id.
+    u32 count;
+    u32 capacity;
+};
+
+static u32
+hash_json_key(String key)
+{
+    // FNV-1a
+    u32 result = 2166136261u;
+    for (mmm idx = 0; idx < key.size; ++idx)
+        result = (result ^ key.data[idx]) * 16777619u;
+    return result;
+}
+
+static void
+init_json_key_table(Json_Key_Table *table, Memory_Arena *arena)
+{
+    *table = {};
+    table->slot_mask = JSON_KEY_TABLE_INITIAL_SLOTS - 1;
+    table->slots = push_array(arena, u32, JSON_KEY_TABLE_INITIAL_SLOTS);
+    table->capacity = JSON_KEY_TABLE_INITIAL_SLOTS / 2;
+    u32 string_count = table->capacity + 1;
+    table->strings = push_array(arena, String, string_count);
+    memset(table->slots, 0, JSON_KEY_TABLE_INITIAL_SLOTS * sizeof(u32));
+}
+
+static u32 *
+find_json_key_slot(Json_Key_Table *table, String key)
+{
+    u32 slot = hash_json_key(key) & table->slot_mask;
+    for (;;)
+    {
+        u32 id = table->slots[slot];
+        if (!id || table->strings[id] == key)
+            return &table->slots[slot];
+        slot = (slot + 1) & table->slot_mask;
+    }
+}
+
+// Id of 'key', or 0 if no object in the document has it.
+static u32
+get_json_key_id(Json_Key_Table *table, const char *key)
+{
+    String key_string = {string_length(key), (u8 *)key};
+    return *find_json_key_slot(table, key_string);
+}
+
+// @NOTE: The table stays at most half full. Growing leaves the old arrays
+// behind in the arena, which is fine for the handful of keys a document has.
+static u32
+intern_json_key(Json_Key_Table *table, String key, Memory_Arena *arena)
+{
+    u32 *slot = find_json_key_slot(table, key);
+    if (!*slot)
+    {
+        if (table->count == table->capacity)
+        {
+            Json_Key_Table grown = *table;
+            u32 slot_count = (table->slot_mask + 1) * 2;
+            grown.slot_mask = slot_count - 1;
+            grown.slots = push_array(arena, u32, slot_count);
+            grown.capacity = slot_count / 2;
+            u32 string_count = grown.capacity + 1;
+            grown.strings = push_array(arena, String, string_count);
+            memset(grown.slots, 0, slot_count * sizeof(u32));
+            memcpy(grown.strings, table->strings, (table->count + 1) * sizeof(String));
+            for (u32 id = 1; id <= table->count; ++id)
+                *find_json_key_slot(&grown, table->strings[id]) = id;
+            *table = grown;
+            slot = find_json_key_slot(table, key);
+        }
+
+        *slot = ++table->count;
+        table->strings[*slot] = key;
+    }
+    return *slot;
+}
+
+static String
+get_json_key_string(Json_Key_Table *table, u32 id)
+{
+    return table->strings[id];
+}
+
 struct Parser
 {
     Token *at;
+    u8 *source;
+    Json_Key_Table *keys;
 
     Token eat()
     {
@@ -295,14 +351,25 @@ struct Parser
     }
 };
 
+static String
+get_token_string(Parser *parser, Token token)
+{
+    String result = {token.size, parser->source + token.offset};
+    return result;
+}
+
 union Json_Value;
 
 struct Json_Object
 {
-    u64 size;
-    u64 used;
-    String *strings;
+    u32 size;
+    u32 used;
+    u32 *key_ids;
     Json_Value *values;
+
+    // Objects wider than JSON_OBJECT_INDEX_THRESHOLD only. index[0] is the
+    // slot mask and the slots follow, each holding a field index + 1.
+    u32 *index;
 };
 
 struct Json_Array
@@ -322,15 +389,84 @@ union Json_Value
 
 static Json_Value parse_value(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena);
 
+// Key id -> field slot, for objects too wide to scan. Ids are small and dense,
+// so the id itself is a good enough hash.
+static void
+build_json_object_index(Json_Object *object, Memory_Arena *data_arena)
+{
+    u32 slot_count = 1;
+    while (slot_count < 2 * object->used)
+        slot_count <<= 1;
+
+    u32 mask = slot_count - 1;
+    u32 index_count = slot_count + 1;
+    u32 *index = push_array_zero(data_arena, u32, index_count);
+    index[0] = mask;
+    u32 *slots = index + 1;
+
+    for (u32 field = 0; field < object->used; ++field)
+    {
+        u32 slot = object->key_ids[field] & mask;
+        while (slots[slot])
+        {
+            // @NOTE: Duplicate keys keep the first occurrence, same as the linear scan.
+            if (object->key_ids[slots[slot] - 1] == object->key_ids[field])
+                break;
+            slot = (slot + 1) & mask;
+        }
+        if (!slots[slot])
+            slots[slot] = field + 1;
+    }
+    object->index = index;
+}
+
+// Value stored under 'key_id' (from get_json_key_id), or 0 if there isn't one.
+static Json_Value *
+json_find(Json_Object *object, u32 key_id)
+{
+    if (object->index)
+    {
+        u32 mask = object->index[0];
+        u32 *slots = object->index + 1;
+        u32 slot = key_id & mask;
+        while (slots[slot])
+        {
+            u32 field = slots[slot] - 1;
+            if (object->key_ids[field] == key_id)
+                return &object->values[field];
+            slot = (slot + 1) & mask;
+        }
+    }
+    else
+    {
+        for (u32 field = 0; field < object->used; ++field)
+        {
+            if (object->key_ids[field] == key_id)
+                return &object->values[field];
+        }
+    }
+    return 0;
+}
+
+// @NOTE: Fields and elements are collected on a scratch arena and copied out
+// once the container is closed, so data_arena only ever gets arrays of the
+// exact size instead of every array they were regrown from. A nested
+// container pushes and pops its own above ours while it's parsed, which
+// leaves ours contiguous.
+struct Json_Field
+{
+    u32 key_id;
+    Json_Value value;
+};
+
 static Json_Object
 parse_object(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena)
 {
     time_function();
 
     Json_Object result = {};
-    result.size = 10;
-    result.strings = push_array(data_arena, String, result.size);
-    result.values = push_array(data_arena, Json_Value, result.size);
+    Temporary_Memory scratch = begin_temporary_memory(get_scratch_arena(data_arena));
+    Json_Field *fields = (Json_Field *)(scratch.arena->base + scratch.arena->used);
 
     if (parser->eat().type == Token_Type_Left_Brace)
     {
@@ -345,26 +481,9 @@ parse_object(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena
                     {
                         Json_Value value = parse_value(parser, token_arena, data_arena);
 
-                        if (result.used == result.size)
-                        {
-                            u64 new_size = (result.size << 1);
-
-                            String *new_strings = push_array(data_arena, String, new_size);
-                            for (u32 i = 0; i < result.size; ++i)
-                                new_strings[i] = result.strings[i];
-
-                            Json_Value *new_values = push_array(data_arena, Json_Value, new_size);
-                            for (u32 i = 0; i < result.size; ++i)
-                                new_values[i] = result.values[i];
-
-                            result.size = new_size;
-
-                            result.values = new_values;
-                            result.strings = new_strings;
-                        }
-
-                        result.strings[result.used] = string_token.buffer;
-                        result.values[result.used] = value;
+                        Json_Field *field = push_struct(scratch.arena, Json_Field);
+                        field->key_id = intern_json_key(parser->keys, get_token_string(parser, string_token), data_arena);
+                        field->value = value;
                         ++result.used;
 
                         Token next = parser->eat();
@@ -398,6 +517,19 @@ parse_object(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena
         invalid_code_path;
     }
 
+    result.size = result.used;
+    result.key_ids = push_array(data_arena, u32, result.used);
+    result.values = push_array(data_arena, Json_Value, result.used);
+    for (u32 i = 0; i < result.used; ++i)
+    {
+        result.key_ids[i] = fields[i].key_id;
+        result.values[i] = fields[i].value;
+    }
+    end_temporary_memory(scratch);
+
+    if (result.used > JSON_OBJECT_INDEX_THRESHOLD)
+        build_json_object_index(&result, data_arena);
+
     return result;
 }
 
@@ -407,8 +539,8 @@ parse_array(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena)
     time_function();
 
     Json_Array result = {};
-    result.size = 10;
-    result.values = push_array(data_arena, Json_Value, 10);
+    Temporary_Memory scratch = begin_temporary_memory(get_scratch_arena(data_arena));
+    Json_Value *values = (Json_Value *)(scratch.arena->base + scratch.arena->used);
 
     if (parser->eat().type == Token_Type_Left_Bracket)
     {
@@ -418,17 +550,8 @@ parse_array(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena)
             {
                 Json_Value value = parse_value(parser, token_arena, data_arena);
 
-                if (result.used == result.size)
-                {
-                    u64 new_size = (result.size << 1);
-                    Json_Value *new_values = push_array(data_arena, Json_Value, new_size);
-                    for (u32 i = 0; i < result.size; ++i)
-                        new_values[i] = result.values[i];
-                    result.size = new_size;
-                    result.values = new_values;
-                }
-
-                result.values[result.used++] = value;
+                *push_struct(scratch.arena, Json_Value) = value;
+                ++result.used;
 
                 Token next = parser->eat();
                 if (next.type == Token_Type_Right_Bracket)
@@ -451,6 +574,11 @@ parse_array(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena)
         invalid_code_path;
     }
 
+    result.size = result.used;
+    result.values = push_array(data_arena, Json_Value, result.used);
+    memcpy(result.values, values, result.used * sizeof(Json_Value));
+    end_temporary_memory(scratch);
+
     return result;
 }
 
@@ -466,13 +594,16 @@ parse_value(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena)
     {
         case Token_Type_String:
         {
-            result.string = token.buffer;
+            result.string = get_token_string(parser, token);
             ++parser->at;
         } break;
         
         case Token_Type_Number:
         {
-            result.number = *((f64 *)token.buffer.data);
+            Stream stream = {parser->source + token.offset};
+            result.number = json_get_number_from_stream(&stream);
+            if (stream.at != parser->source + token.offset + token.size)
+                invalid_code_path;
             ++parser->at;
         } break;
 
@@ -492,13 +623,20 @@ parse_value(Parser *parser, Memory_Arena *token_arena, Memory_Arena *data_arena)
     return result;
 }
 
+// Keys are interned into 'keys', which has to outlive the returned object.
+// It's initialized here unless it already holds keys from another document.
 static Json_Object
-parse_json(Memory_Arena *token_arena, Memory_Arena *data_arena)
+parse_json(Buffer source, Memory_Arena *token_arena, Memory_Arena *data_arena, Json_Key_Table *keys)
 {
-    time_function();
+    time_bandwidth(__func__, source.size);
+
+    if (!keys->slots)
+        init_json_key_table(keys, data_arena);
 
     Parser parser = {};
     parser.at = (Token *)token_arena->base;
+    parser.source = source.data;
+    parser.keys = keys;
 
     Json_Object result = parse_object(&parser, token_arena, data_arena);
 
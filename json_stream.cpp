@@ -0,0 +1,406 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Resumable push tokenizer + parser. The input is fed in chunks of any size
+// and the only state carried between them is the container stack and one
+// literal that straddles the chunk boundary, so memory use doesn't depend on
+// the size of the document.
+//
+// Literals that fit inside a chunk are handed out in place. Only a literal
+// split across chunks is copied, onto 'pending_arena', which grows to fit it.
+// So memory use is bounded by the longest literal that happens to straddle a
+// boundary (at most the longest in the document), never by the chunk size,
+// and no valid input is rejected because of where the chunks were cut.
+//
+
+#define JSON_STREAM_MAX_DEPTH           64
+#define JSON_STREAM_PENDING_SIZE        KB(4)
+
+enum Json_Event_Type
+{
+    Json_Event_Type_Begin_Object,
+    Json_Event_Type_End_Object,
+    Json_Event_Type_Begin_Array,
+    Json_Event_Type_End_Array,
+    Json_Event_Type_Key,
+    Json_Event_Type_String,
+    Json_Event_Type_Number,
+};
+
+struct Json_Event
+{
+    Json_Event_Type type;
+    u32 depth;      // Number of containers enclosing this value.
+    String string;  // Key and String only. Valid during the callback only.
+    f64 number;
+};
+
+typedef void Json_Event_Callback(void *user_data, Json_Event *event);
+
+enum Json_Lex_State
+{
+    Json_Lex_State_Default,
+    Json_Lex_State_String,
+    Json_Lex_State_Number,
+};
+
+enum Json_Expect
+{
+    Json_Expect_Value,
+    Json_Expect_Value_Or_End,
+    Json_Expect_Key,
+    Json_Expect_Key_Or_End,
+    Json_Expect_Colon,
+    Json_Expect_Comma_Or_End,
+    Json_Expect_Done,
+};
+
+struct Json_Stream
+{
+    Json_Event_Callback *callback;
+    void *user_data;
+
+    Json_Lex_State lex_state;
+    Json_Expect expect;
+    b32 string_is_key;
+    b32 escape_pending;
+    b32 error;
+
+    u32 depth;
+    u8 container_stack[JSON_STREAM_MAX_DEPTH];
+
+    Memory_Arena pending_arena;
+    mmm pending_size;
+
+    u64 byte_offset;
+};
+
+static void
+init_json_stream(Json_Stream *stream, Json_Event_Callback *callback, void *user_data)
+{
+    *stream = {};
+    stream->callback = callback;
+    stream->user_data = user_data;
+    stream->expect = Json_Expect_Value;
+    init_arena(&stream->pending_arena, JSON_STREAM_PENDING_SIZE);
+}
+
+static void
+close_json_stream(Json_Stream *stream)
+{
+    release_arena(&stream->pending_arena);
+}
+
+static void
+json_stream_fail(Json_Stream *stream, u8 *at, u8 *chunk_begin)
+{
+    if (!stream->error)
+    {
+        stream->error = true;
+        fprintf(stderr, "[ERROR]: Malformed json near byte %llu.\n", stream->byte_offset + (u64)(at - chunk_begin));
+    }
+}
+
+static void
+json_stream_emit(Json_Stream *stream, Json_Event_Type type, u32 depth)
+{
+    Json_Event event = {};
+    event.type = type;
+    event.depth = depth;
+    stream->callback(stream->user_data, &event);
+}
+
+static void
+json_stream_end_value(Json_Stream *stream)
+{
+    stream->expect = (stream->depth ? Json_Expect_Comma_Or_End : Json_Expect_Done);
+}
+
+static void
+json_stream_begin_pending(Json_Stream *stream)
+{
+    reset_arena(&stream->pending_arena);
+    stream->pending_size = 0;
+}
+
+// @NOTE: Nothing else is pushed onto pending_arena, so every append lands
+// right after the last one and the literal stays contiguous from its base.
+static void
+json_stream_append_pending(Json_Stream *stream, u8 *begin, u8 *end)
+{
+    mmm size = (mmm)(end - begin);
+    memcpy(push_size(&stream->pending_arena, size), begin, size);
+    stream->pending_size += size;
+}
+
+static void
+json_stream_emit_string(Json_Stream *stream, String string)
+{
+    Json_Event event = {};
+    event.type = (stream->string_is_key ? Json_Event_Type_Key : Json_Event_Type_String);
+    event.depth = stream->depth;
+    event.string = string;
+    stream->callback(stream->user_data, &event);
+
+    if (stream->string_is_key)
+        stream->expect = Json_Expect_Colon;
+    else
+        json_stream_end_value(stream);
+}
+
+// @NOTE: The byte at 'end' is never part of a number (it's either the next
+// token or the terminator in 'pending'), so the number parser stops there.
+static b32
+json_stream_emit_number(Json_Stream *stream, u8 *begin, u8 *end)
+{
+    Stream number_stream = {};
+    number_stream.at = begin;
+
+    Json_Event event = {};
+    event.type = Json_Event_Type_Number;
+    event.depth = stream->depth;
+    event.number = json_get_number_from_stream(&number_stream);
+
+    b32 result = (number_stream.at == end);
+    if (result)
+    {
+        stream->callback(stream->user_data, &event);
+        json_stream_end_value(stream);
+    }
+    return result;
+}
+
+// Null terminates the pending number (see json_stream_emit_number) and emits it.
+static b32
+json_stream_emit_pending_number(Json_Stream *stream)
+{
+    *(u8 *)push_size(&stream->pending_arena, 1) = 0;
+    u8 *pending = stream->pending_arena.base;
+    stream->lex_state = Json_Lex_State_Default;
+    return json_stream_emit_number(stream, pending, pending + stream->pending_size);
+}
+
+// Scans a string body starting at 'at'. Returns the position of the closing
+// quote, or 'end' if the chunk ran out first.
+static u8 *
+json_stream_scan_string(Json_Stream *stream, u8 *at, u8 *end)
+{
+    while (at < end)
+    {
+        u8 c = *at;
+        if (stream->escape_pending)
+            stream->escape_pending = false;
+        else if (c == '\\')
+            stream->escape_pending = true;
+        else if (c == '"')
+            break;
+        ++at;
+    }
+    return at;
+}
+
+static u8 *
+json_stream_scan_number(u8 *at, u8 *end)
+{
+    while (at < end && is_number_char(*at))
+        ++at;
+    return at;
+}
+
+static b32
+json_stream_feed(Json_Stream *stream, u8 *data, mmm size)
+{
+    time_bandwidth(__func__, size);
+
+    u8 *at = data;
+    u8 *end = data + size;
+
+    if (stream->lex_state == Json_Lex_State_String)
+    {
+        u8 *close = json_stream_scan_string(stream, at, end);
+        json_stream_append_pending(stream, at, close);
+        if (close < end)
+        {
+            String string = {stream->pending_size, stream->pending_arena.base};
+            stream->lex_state = Json_Lex_State_Default;
+            json_stream_emit_string(stream, string);
+        }
+        at = (close < end) ? close + 1 : end;
+    }
+    else if (stream->lex_state == Json_Lex_State_Number)
+    {
+        u8 *number_end = json_stream_scan_number(at, end);
+        json_stream_append_pending(stream, at, number_end);
+        if (number_end < end)
+        {
+            if (!json_stream_emit_pending_number(stream))
+                json_stream_fail(stream, at, data);
+        }
+        at = number_end;
+    }
+
+    while (at < end && !stream->error)
+    {
+        u8 c = *at;
+        Json_Expect expect = stream->expect;
+        switch (c)
+        {
+            case ' ':
+            case '\n':
+            case '\r':
+            case '\t':
+            {
+                ++at;
+            } break;
+
+            case '{':
+            case '[':
+            {
+                if ((expect == Json_Expect_Value || expect == Json_Expect_Value_Or_End) &&
+                    (stream->depth < JSON_STREAM_MAX_DEPTH))
+                {
+                    b32 is_object = (c == '{');
+                    json_stream_emit(stream, is_object ? Json_Event_Type_Begin_Object : Json_Event_Type_Begin_Array, stream->depth);
+                    stream->container_stack[stream->depth++] = c;
+                    stream->expect = (is_object ? Json_Expect_Key_Or_End : Json_Expect_Value_Or_End);
+                    ++at;
+                }
+                else
+                {
+                    json_stream_fail(stream, at, data);
+                }
+            } break;
+
+            case '}':
+            case ']':
+            {
+                u8 open = ((c == '}') ? '{' : '[');
+                b32 can_close = (expect == Json_Expect_Comma_Or_End) ||
+                                (open == '{' && expect == Json_Expect_Key_Or_End) ||
+                                (open == '[' && expect == Json_Expect_Value_Or_End);
+                if (stream->depth && stream->container_stack[stream->depth - 1] == open && can_close)
+                {
+                    --stream->depth;
+                    json_stream_emit(stream, (c == '}') ? Json_Event_Type_End_Object : Json_Event_Type_End_Array, stream->depth);
+                    json_stream_end_value(stream);
+                    ++at;
+                }
+                else
+                {
+                    json_stream_fail(stream, at, data);
+                }
+            } break;
+
+            case ',':
+            {
+                if (expect == Json_Expect_Comma_Or_End)
+                {
+                    b32 in_object = (stream->container_stack[stream->depth - 1] == '{');
+                    stream->expect = (in_object ? Json_Expect_Key : Json_Expect_Value);
+                    ++at;
+                }
+                else
+                {
+                    json_stream_fail(stream, at, data);
+                }
+            } break;
+
+            case ':':
+            {
+                if (expect == Json_Expect_Colon)
+                {
+                    stream->expect = Json_Expect_Value;
+                    ++at;
+                }
+                else
+                {
+                    json_stream_fail(stream, at, data);
+                }
+            } break;
+
+            case '"':
+            {
+                b32 is_key = (expect == Json_Expect_Key || expect == Json_Expect_Key_Or_End);
+                b32 is_value = (expect == Json_Expect_Value || expect == Json_Expect_Value_Or_End);
+                if (is_key || is_value)
+                {
+                    stream->string_is_key = is_key;
+
+                    u8 *begin = at + 1;
+                    u8 *close = json_stream_scan_string(stream, begin, end);
+                    if (close < end)
+                    {
+                        String string = {(mmm)(close - begin), begin};
+                        json_stream_emit_string(stream, string);
+                        at = close + 1;
+                    }
+                    else
+                    {
+                        json_stream_begin_pending(stream);
+                        json_stream_append_pending(stream, begin, end);
+                        stream->lex_state = Json_Lex_State_String;
+                        at = end;
+                    }
+                }
+                else
+                {
+                    json_stream_fail(stream, at, data);
+                }
+            } break;
+
+            default:
+            {
+                b32 is_value = (expect == Json_Expect_Value || expect == Json_Expect_Value_Or_End);
+                if (is_value && (c == '-' || (c >= '0' && c <= '9')))
+                {
+                    u8 *number_end = json_stream_scan_number(at, end);
+                    if (number_end < end)
+                    {
+                        if (!json_stream_emit_number(stream, at, number_end))
+                            json_stream_fail(stream, at, data);
+                    }
+                    else
+                    {
+                        json_stream_begin_pending(stream);
+                        json_stream_append_pending(stream, at, end);
+                        stream->lex_state = Json_Lex_State_Number;
+                    }
+                    at = number_end;
+                }
+                else
+                {
+                    json_stream_fail(stream, at, data);
+                }
+            } break;
+        }
+    }
+
+    stream->byte_offset += size;
+    return !stream->error;
+}
+
+static b32
+json_stream_finish(Json_Stream *stream)
+{
+    if (!stream->error && stream->lex_state == Json_Lex_State_Number)
+    {
+        if (!json_stream_emit_pending_number(stream))
+            stream->error = true;
+    }
+
+    if (stream->lex_state != Json_Lex_State_Default || stream->expect != Json_Expect_Done)
+        stream->error = true;
+
+    return !stream->error;
+}
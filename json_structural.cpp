@@ -0,0 +1,313 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Two-stage tokenizer.
+//
+// Stage 1 classifies 64 bytes at a time into bitmasks (structural characters,
+// quotes, whitespace, digits), works out which bytes are inside strings with a
+// prefix-xor over the unescaped quotes, and writes the offset of every
+// structural character, opening and closing quote and number start into an
+// index.
+//
+// Stage 2 walks that index and only ever looks at the bytes where a token
+// starts or a string ends, so whitespace and string bodies are never visited
+// one byte at a time.
+//
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#endif
+
+struct Json_Block_Masks
+{
+    u64 structural;   // { } [ ] : ,
+    u64 whitespace;
+    u64 quote;
+    u64 backslash;
+    u64 digit;
+    u64 minus;
+};
+
+struct Json_Scanner
+{
+    u8 *base;
+    mmm size;
+    mmm offset;
+
+    mmm batch_offset;     // Index entries are relative to this.
+
+    u64 prev_in_string;   // All ones if the previous block ended inside a string.
+    u64 prev_escaped;     // 1 if the first byte of this block is escaped.
+    u64 prev_scalar;      // 1 if the previous block ended in the middle of a scalar.
+    u64 error;
+};
+
+#if defined(__AVX2__)
+static u64
+avx2_mask(__m256i lo, __m256i hi)
+{
+    u64 a = (u32)_mm256_movemask_epi8(lo);
+    u64 b = (u32)_mm256_movemask_epi8(hi);
+    return (a | (b << 32));
+}
+
+static u64
+avx2_eq_mask(__m256i lo, __m256i hi, char c)
+{
+    __m256i v = _mm256_set1_epi8(c);
+    return avx2_mask(_mm256_cmpeq_epi8(lo, v), _mm256_cmpeq_epi8(hi, v));
+}
+
+// @NOTE: Punctuation and whitespace are looked up by the low nibble with one
+// shuffle each. For punctuation, OR-ing in 0x20 folds '[' ']' onto '{' '}'.
+// The only false positives are control bytes, which can't appear in valid json.
+static Json_Block_Masks
+classify_block(u8 *block)
+{
+    __m256i lo = _mm256_loadu_si256((__m256i *)block);
+    __m256i hi = _mm256_loadu_si256((__m256i *)(block + 32));
+
+    __m256i op_table = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+                                        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+    __m256i whitespace_table = _mm256_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100,
+                                                ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100);
+    __m256i case_bit = _mm256_set1_epi8(0x20);
+    __m256i zero = _mm256_set1_epi8('0');
+    __m256i nine = _mm256_set1_epi8(9);
+
+    __m256i lo_digit = _mm256_sub_epi8(lo, zero);
+    __m256i hi_digit = _mm256_sub_epi8(hi, zero);
+
+    Json_Block_Masks result;
+    result.structural = avx2_mask(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(op_table, lo), _mm256_or_si256(lo, case_bit)),
+                                  _mm256_cmpeq_epi8(_mm256_shuffle_epi8(op_table, hi), _mm256_or_si256(hi, case_bit)));
+    result.whitespace = avx2_mask(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(whitespace_table, lo), lo),
+                                  _mm256_cmpeq_epi8(_mm256_shuffle_epi8(whitespace_table, hi), hi));
+    result.quote = avx2_eq_mask(lo, hi, '"');
+    result.backslash = avx2_eq_mask(lo, hi, '\\');
+    result.digit = avx2_mask(_mm256_cmpeq_epi8(_mm256_min_epu8(lo_digit, nine), lo_digit),
+                             _mm256_cmpeq_epi8(_mm256_min_epu8(hi_digit, nine), hi_digit));
+    result.minus = avx2_eq_mask(lo, hi, '-');
+    return result;
+}
+#else
+static Json_Block_Masks
+classify_block(u8 *block)
+{
+    Json_Block_Masks result = {};
+    for (u32 idx = 0; idx < 64; ++idx)
+    {
+        u8 c = block[idx];
+        u64 bit = (1ull << idx);
+        if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',')
+            result.structural |= bit;
+        else if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+            result.whitespace |= bit;
+        else if (c == '"')
+            result.quote |= bit;
+        else if (c == '\\')
+            result.backslash |= bit;
+        else if (c >= '0' && c <= '9')
+            result.digit |= bit;
+        else if (c == '-')
+            result.minus |= bit;
+    }
+    return result;
+}
+#endif
+
+// Bit i of the result is the xor of bits 0..i, i.e. 1 from an opening quote up
+// to (not including) its closing quote.
+static u64
+prefix_xor(u64 x)
+{
+    x ^= (x << 1);
+    x ^= (x << 2);
+    x ^= (x << 4);
+    x ^= (x << 8);
+    x ^= (x << 16);
+    x ^= (x << 32);
+    return x;
+}
+
+// @NOTE: A byte is escaped when it follows an odd-length run of backslashes.
+// Runs are found with a carrying add over the odd/even bit positions, and the
+// carry out is the 'escaped' state for the next block.
+static u64
+find_escaped(Json_Scanner *scanner, u64 backslash)
+{
+    if (!backslash)
+    {
+        u64 result = scanner->prev_escaped;
+        scanner->prev_escaped = 0;
+        return result;
+    }
+
+    u64 even_bits = 0x5555555555555555ull;
+
+    backslash &= ~scanner->prev_escaped;
+    u64 follows_escape = (backslash << 1) | scanner->prev_escaped;
+    u64 odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+
+    u64 sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    scanner->prev_escaped = (sequences_starting_on_even_bits < backslash);
+
+    u64 invert_mask = (sequences_starting_on_even_bits << 1);
+    return ((even_bits ^ invert_mask) & follows_escape);
+}
+
+static void
+init_json_scanner(Json_Scanner *scanner, Buffer buffer)
+{
+    *scanner = {};
+    scanner->base = buffer.data;
+    scanner->size = buffer.size;
+}
+
+// Fills 'index' with the offsets (relative to scanner->batch_offset) of the
+// next structurals and returns how many were written. Returns 0 once the whole
+// buffer has been scanned. 'index' needs 64 entries of slack past the count.
+static u32
+scan_structurals(Json_Scanner *scanner, u32 *index, u32 index_capacity)
+{
+    u32 count = 0;
+    scanner->batch_offset = scanner->offset;
+
+    while ((scanner->offset < scanner->size) &&
+           (count + 64 <= index_capacity) &&
+           (scanner->offset - scanner->batch_offset < ((mmm)1 << 31)))
+    {
+        u8 *block = scanner->base + scanner->offset;
+        u8 padded[64];
+        mmm remaining = scanner->size - scanner->offset;
+        if (remaining < 64)
+        {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, remaining);
+            block = padded;
+        }
+
+        Json_Block_Masks masks = classify_block(block);
+
+        u64 escaped = find_escaped(scanner, masks.backslash);
+        u64 quote = masks.quote & ~escaped;
+        u64 in_string = prefix_xor(quote) ^ scanner->prev_in_string;
+        scanner->prev_in_string = (u64)((s64)in_string >> 63);
+
+        // @NOTE: A scalar is anything that isn't whitespace or punctuation, and
+        // only the first byte of each run is a token start. The opening quote
+        // of a string counts as one; everything after it up to and including
+        // the closing quote is masked out.
+        u64 scalar = ~(masks.structural | masks.whitespace);
+        u64 nonquote_scalar = scalar & ~quote;
+        u64 follows_nonquote_scalar = (nonquote_scalar << 1) | scanner->prev_scalar;
+        scanner->prev_scalar = (nonquote_scalar >> 63);
+
+        u64 scalar_start = scalar & ~follows_nonquote_scalar;
+        u64 string_tail = in_string ^ quote;
+        u64 closing_quote = quote & ~in_string;
+        u64 structurals = ((masks.structural | scalar_start) & ~string_tail) | closing_quote;
+
+        if (remaining < 64)
+            structurals &= ((1ull << remaining) - 1);
+
+        // Every token that isn't punctuation or a string has to start like a number.
+        scanner->error |= (scalar_start & ~string_tail & ~quote & ~masks.digit & ~masks.minus & structurals);
+
+        // @NOTE: Writing 8 entries unconditionally is cheaper than a
+        // data-dependent loop exit; the extra slots are overwritten later.
+        u32 base_offset = (u32)(scanner->offset - scanner->batch_offset);
+        u32 structural_count = count_set_bits(structurals);
+        u32 *out = index + count;
+        for (u32 idx = 0; idx < 8; ++idx)
+        {
+            out[idx] = base_offset + count_trailing_zeros(structurals | (1ull << 63));
+            structurals &= (structurals - 1);
+        }
+        if (structural_count > 8)
+        {
+            for (u32 idx = 8; idx < 16; ++idx)
+            {
+                out[idx] = base_offset + count_trailing_zeros(structurals | (1ull << 63));
+                structurals &= (structurals - 1);
+            }
+            for (u32 idx = 16; structurals; ++idx)
+            {
+                out[idx] = base_offset + count_trailing_zeros(structurals);
+                structurals &= (structurals - 1);
+            }
+        }
+        count += structural_count;
+
+        scanner->offset += 64;
+    }
+
+    return count;
+}
+
+static void
+tokenize_structural(Buffer buffer, Memory_Arena *token_arena)
+{
+    time_bandwidth(__func__, buffer.size);
+
+    Json_Scanner scanner;
+    init_json_scanner(&scanner, buffer);
+
+    assert(buffer.size < ((mmm)1 << 32));
+
+    u32 index[4096];
+    Tokenizer tk = {};
+    tk.base = buffer.data;
+
+    // @NOTE: Non-zero between an opening quote and its closing quote, which is
+    // the next index entry but can be in the next batch.
+    u8 *string_open = 0;
+
+    for (;;)
+    {
+        u32 count = scan_structurals(&scanner, index, array_count(index));
+        if (!count && scanner.offset >= scanner.size)
+            break;
+
+        for (u32 idx = 0; idx < count; ++idx)
+        {
+            u8 *at = buffer.data + scanner.batch_offset + index[idx];
+            if (string_open)
+            {
+                tk.at = string_open;
+                push_string_token(&tk, at, token_arena);
+                string_open = 0;
+                continue;
+            }
+
+            tk.at = at;
+            switch (*tk.at)
+            {
+                case '{': { push_token(&tk, Token_Type_Left_Brace, token_arena);    } break;
+                case '}': { push_token(&tk, Token_Type_Right_Brace, token_arena);   } break;
+                case '[': { push_token(&tk, Token_Type_Left_Bracket, token_arena);  } break;
+                case ']': { push_token(&tk, Token_Type_Right_Bracket, token_arena); } break;
+                case ',': { push_token(&tk, Token_Type_Comma, token_arena);         } break;
+                case ':': { push_token(&tk, Token_Type_Colon, token_arena);         } break;
+                case '"': { string_open = tk.at;                                    } break;
+                default:  { push_token(&tk, Token_Type_Number, token_arena);        } break;
+            }
+        }
+    }
+
+    if (scanner.error || scanner.prev_in_string || string_open)
+        invalid_code_path;
+
+    push_token(&tk, Token_Type_EOF, token_arena);
+}
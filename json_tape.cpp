@@ -0,0 +1,280 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Tape DOM. The whole document is a single array of u64 words in document
+// order; the top byte of each word is its type and the low 56 bits its payload.
+//
+//   'r'        root     index one past the last word of the document
+//   '{' '['    open     low 32 bits: index one past the matching close
+//                       bits 32..55: number of children (saturates)
+//   '}' ']'    close    index of the matching open
+//   '"'        string   low 32 bits: offset into the source, bits 32..55: size
+//   'd'        number   the next word holds the bits of the f64
+//
+// Children sit right after their container, so stepping over a value is O(1)
+// whatever it contains, and no word is ever moved once it's written.
+//
+
+#define JSON_TAPE_PAYLOAD_MASK  0x00FFFFFFFFFFFFFFull
+#define JSON_TAPE_MAX_COUNT     0x00FFFFFF
+
+enum Json_Tape_Type
+{
+    Json_Tape_Type_Root         = 'r',
+    Json_Tape_Type_Begin_Object = '{',
+    Json_Tape_Type_End_Object   = '}',
+    Json_Tape_Type_Begin_Array  = '[',
+    Json_Tape_Type_End_Array    = ']',
+    Json_Tape_Type_String       = '"',
+    Json_Tape_Type_Number       = 'd',
+};
+
+struct Json_Tape
+{
+    u64 *words;
+    u32 word_count;
+    u8 *source;
+};
+
+// A value on the tape. An index of 0 (the root word) means 'no value'.
+struct Json_Ref
+{
+    Json_Tape *tape;
+    u32 index;
+};
+
+static u64
+make_tape_word(Json_Tape_Type type, u64 payload)
+{
+    return (((u64)type << 56) | payload);
+}
+
+static u32
+append_tape_word(Json_Tape *tape, Memory_Arena *tape_arena, u64 word)
+{
+    *push_struct(tape_arena, u64) = word;
+    return tape->word_count++;
+}
+
+static void parse_tape_value(Parser *parser, Json_Tape *tape, Memory_Arena *tape_arena);
+
+static void
+parse_tape_container(Parser *parser, Json_Tape *tape, Memory_Arena *tape_arena)
+{
+    Token open = parser->eat();
+    b32 is_object = (open.type == Token_Type_Left_Brace);
+    Token_Type close_type = (is_object ? Token_Type_Right_Brace : Token_Type_Right_Bracket);
+
+    u32 open_index = append_tape_word(tape, tape_arena, 0);
+    u64 count = 0;
+
+    if (parser->at->type == close_type)
+    {
+        ++parser->at;
+    }
+    else
+    {
+        for (;;)
+        {
+            if (is_object)
+            {
+                Token key = parser->eat();
+                if (key.type != Token_Type_String)
+                    invalid_code_path;
+                append_tape_word(tape, tape_arena, make_tape_word(Json_Tape_Type_String, key.offset | ((u64)key.size << 32)));
+
+                if (parser->eat().type != Token_Type_Colon)
+                    invalid_code_path;
+            }
+
+            parse_tape_value(parser, tape, tape_arena);
+            ++count;
+
+            Token next = parser->eat();
+            if (next.type == close_type)
+                break;
+            else if (next.type != Token_Type_Comma)
+                invalid_code_path;
+        }
+    }
+
+    if (count > JSON_TAPE_MAX_COUNT)
+        count = JSON_TAPE_MAX_COUNT;
+
+    u32 close_index = append_tape_word(tape, tape_arena, make_tape_word(is_object ? Json_Tape_Type_End_Object : Json_Tape_Type_End_Array, open_index));
+    tape->words[open_index] = make_tape_word(is_object ? Json_Tape_Type_Begin_Object : Json_Tape_Type_Begin_Array,
+                                             (u64)(close_index + 1) | (count << 32));
+}
+
+static void
+parse_tape_value(Parser *parser, Json_Tape *tape, Memory_Arena *tape_arena)
+{
+    Token token = *parser->at;
+    switch (token.type)
+    {
+        case Token_Type_String:
+        {
+            append_tape_word(tape, tape_arena, make_tape_word(Json_Tape_Type_String, token.offset | ((u64)token.size << 32)));
+            ++parser->at;
+        } break;
+
+        case Token_Type_Number:
+        {
+            Stream stream = {parser->source + token.offset};
+            f64 number = json_get_number_from_stream(&stream);
+            if (stream.at != parser->source + token.offset + token.size)
+                invalid_code_path;
+
+            u64 bits;
+            memcpy(&bits, &number, sizeof(bits));
+            append_tape_word(tape, tape_arena, make_tape_word(Json_Tape_Type_Number, 0));
+            append_tape_word(tape, tape_arena, bits);
+            ++parser->at;
+        } break;
+
+        case Token_Type_Left_Brace:
+        case Token_Type_Left_Bracket:
+        {
+            parse_tape_container(parser, tape, tape_arena);
+        } break;
+
+        invalid_default_case;
+    }
+}
+
+// Builds the tape from the tokens in token_arena. The tape's words are the
+// only thing pushed onto tape_arena, so they end up contiguous.
+static Json_Tape
+parse_json_tape(Buffer source, Memory_Arena *token_arena, Memory_Arena *tape_arena)
+{
+    time_bandwidth(__func__, source.size);
+
+    Json_Tape tape = {};
+    tape.source = source.data;
+    tape.words = (u64 *)(tape_arena->base + tape_arena->used);
+
+    Parser parser = {};
+    parser.at = (Token *)token_arena->base;
+    parser.source = source.data;
+
+    append_tape_word(&tape, tape_arena, 0);
+    parse_tape_value(&parser, &tape, tape_arena);
+    if (parser.at->type != Token_Type_EOF)
+        invalid_code_path;
+
+    tape.words[0] = make_tape_word(Json_Tape_Type_Root, tape.word_count);
+    return tape;
+}
+
+//
+// Accessors
+//
+
+static Json_Ref
+json_tape_root(Json_Tape *tape)
+{
+    Json_Ref result = {tape, 1};
+    return result;
+}
+
+static Json_Tape_Type
+json_tape_type(Json_Ref ref)
+{
+    return (Json_Tape_Type)(ref.tape->words[ref.index] >> 56);
+}
+
+static u64
+json_tape_payload(Json_Ref ref)
+{
+    return (ref.tape->words[ref.index] & JSON_TAPE_PAYLOAD_MASK);
+}
+
+static b32
+json_tape_is_valid(Json_Ref ref)
+{
+    return (ref.index != 0);
+}
+
+// Number of elements, or key/value pairs, in a container.
+static u32
+json_tape_count(Json_Ref container)
+{
+    return (u32)(json_tape_payload(container) >> 32);
+}
+
+// The first child of a container. For an object that's the first key, and its
+// value is json_tape_next() of it.
+static Json_Ref
+json_tape_first(Json_Ref container)
+{
+    Json_Ref result = {container.tape, container.index + 1};
+    return result;
+}
+
+static b32
+json_tape_at_end(Json_Ref ref)
+{
+    Json_Tape_Type type = json_tape_type(ref);
+    return (type == Json_Tape_Type_End_Object || type == Json_Tape_Type_End_Array);
+}
+
+static Json_Ref
+json_tape_next(Json_Ref ref)
+{
+    Json_Ref result = ref;
+    switch (json_tape_type(ref))
+    {
+        case Json_Tape_Type_Begin_Object:
+        case Json_Tape_Type_Begin_Array:
+        {
+            result.index = (u32)json_tape_payload(ref);
+        } break;
+
+        case Json_Tape_Type_Number: { result.index += 2; } break;
+        default:                    { result.index += 1; } break;
+    }
+    return result;
+}
+
+static String
+json_tape_string(Json_Ref ref)
+{
+    u64 payload = json_tape_payload(ref);
+    String result = {(mmm)(payload >> 32), ref.tape->source + (u32)payload};
+    return result;
+}
+
+static f64
+json_tape_number(Json_Ref ref)
+{
+    f64 result;
+    memcpy(&result, &ref.tape->words[ref.index + 1], sizeof(result));
+    return result;
+}
+
+// Value stored under 'key', or an invalid ref if there isn't one.
+static Json_Ref
+json_tape_find(Json_Ref object, const char *key)
+{
+    Json_Ref result = {object.tape, 0};
+    for (Json_Ref it = json_tape_first(object); !json_tape_at_end(it); it = json_tape_next(json_tape_next(it)))
+    {
+        if (json_tape_string(it) == key)
+        {
+            result = json_tape_next(it);
+            break;
+        }
+    }
+    return result;
+}
@@ -12,6 +12,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "core.h"
@@ -19,19 +20,22 @@
 #include "memory.cpp"
 #include "profiler.cpp"
 #include "haversine_shared.cpp"
+#include "haversine_binary.cpp"
+#include "job_system.cpp"
+#include "haversine_batch.cpp"
+#include "json_number.cpp"
 #include "json_parser.cpp"
-
-static f64
-abs(f64 x)
-{
-    return ((x > 0) ? x : -x);
-}
+#include "json_tape.cpp"
+#include "json_direct.cpp"
+#include "json_parallel.cpp"
+#include "json_cursor.cpp"
+#include "json_structural.cpp"
+#include "json_stream.cpp"
+#include "async_io.cpp"
 
 internal Buffer
 read_entire_file_and_null_terminate(const char *filename, Memory_Arena *arena)
 {
-    time_function();
-
     Buffer result = {};
 
     FILE *file = fopen(filename, "rb");
@@ -39,8 +43,10 @@ read_entire_file_and_null_terminate(const char *filename, Memory_Arena *arena)
     {
         fseek(file, 0, SEEK_END);
         result.size = (mmm)ftell(file);
-        result.data = (u8 *)push_size(arena, result.size + 1);
         fseek(file, 0, SEEK_SET);
+
+        time_bandwidth(__func__, result.size);
+        result.data = (u8 *)push_size(arena, result.size + 1);
         fread(result.data, result.size, 1, file);
         result.data[result.size] = 0;
         fclose(file);
@@ -52,6 +58,51 @@ read_entire_file_and_null_terminate(const char *filename, Memory_Arena *arena)
     return result;
 }
 
+// Reads into explicit large pages, or returns nothing if the OS has none to
+// give (on Linux, unless vm.nr_hugepages was raised). Free with
+// free_large_page_file().
+internal Buffer
+read_entire_file_into_large_pages(const char *filename)
+{
+    Buffer result = {};
+
+    mmm large_page_size = get_large_page_size();
+    FILE *file = fopen(filename, "rb");
+    if (file && large_page_size)
+    {
+        fseek(file, 0, SEEK_END);
+        mmm size = (mmm)ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        u8 *data = (u8 *)allocate_large_pages(align_arena_size(size + 1, large_page_size));
+        if (data)
+        {
+            time_bandwidth(__func__, size);
+            result.size = fread(data, 1, size, file);
+            result.data = data;
+            result.data[result.size] = 0;
+        }
+    }
+    if (file)
+        fclose(file);
+    return result;
+}
+
+internal void
+free_large_page_file(Buffer file)
+{
+    free_large_pages(file.data, align_arena_size(file.size + 1, get_large_page_size()));
+}
+
+internal Buffer
+map_entire_file_for_tokenizer(const char *filename, b32 prefault)
+{
+    time_function();
+
+    Buffer result = map_entire_file_and_null_terminate(filename, prefault);
+    return result;
+}
+
 //
 // OBJECT
 // { STRING : VALUE }
@@ -65,42 +116,96 @@ read_entire_file_and_null_terminate(const char *filename, Memory_Arena *arena)
 // STRING|NUMBER|OBJECT|ARRAY|TRUE|FALSE|NULL
 //
 
-struct Haversine_Pair
-{
-    f64 x0, y0, x1, y1;
-};
-
+// With 'jobs' the pairs are summed across its workers, otherwise on this thread.
 static f64
-get_haversine_sum_from_json(Json_Object object, Memory_Arena *arena)
+get_haversine_sum_from_json(Json_Object object, Json_Key_Table *keys, Job_System *jobs, Memory_Arena *arena)
 {
     time_function();
     f64 result = 0.0;
  
-    if (object.strings[0] == "pairs")
+    // @NOTE: Key strings are resolved to ids once; inside the loop every lookup is an integer compare.
+    u32 pairs_id = get_json_key_id(keys, "pairs");
+    u32 x0_id = get_json_key_id(keys, "x0");
+    u32 y0_id = get_json_key_id(keys, "y0");
+    u32 x1_id = get_json_key_id(keys, "x1");
+    u32 y1_id = get_json_key_id(keys, "y1");
+
+    Json_Value *pairs_value = json_find(&object, pairs_id);
+    if (pairs_value)
     {
-        Json_Value val = object.values[0];
-        u64 pairs_count = val.array.used;
+        Json_Array pairs_array = pairs_value->array;
+        u64 pairs_count = pairs_array.used;
         Haversine_Pair *pairs = push_array(arena, Haversine_Pair, pairs_count);
         for (u32 idx = 0; idx < pairs_count; ++idx)
         {
-            Json_Object pair = val.array.values[idx].object;
-            for (u32 i = 0; i < 4; ++i)
+            Json_Object *pair = &pairs_array.values[idx].object;
+            Json_Value *x0 = json_find(pair, x0_id);
+            Json_Value *y0 = json_find(pair, y0_id);
+            Json_Value *x1 = json_find(pair, x1_id);
+            Json_Value *y1 = json_find(pair, y1_id);
+            if (!x0 || !y0 || !x1 || !y1)
             {
-                if (pair.strings[i] == "x0")
+                invalid_code_path;
+            }
+
+            pairs[idx].x0 = x0->number;
+            pairs[idx].y0 = y0->number;
+            pairs[idx].x1 = x1->number;
+            pairs[idx].y1 = y1->number;
+        }
+
+        result = parallel_haversine_sum_pairs(jobs, pairs, pairs_count, arena);
+    }
+    else
+    {
+        invalid_code_path;
+    }
+
+    return result;
+}
+
+static f64
+get_haversine_sum_from_json_tape(Json_Tape *tape, Job_System *jobs, Memory_Arena *arena)
+{
+    time_function();
+    f64 result = 0.0;
+
+    Json_Ref pairs_array = json_tape_find(json_tape_root(tape), "pairs");
+    if (json_tape_is_valid(pairs_array) && json_tape_type(pairs_array) == Json_Tape_Type_Begin_Array)
+    {
+        // @NOTE: The tape saturates counts at JSON_TAPE_MAX_COUNT; past that the elements are counted by walking them.
+        u64 pairs_count = json_tape_count(pairs_array);
+        if (pairs_count == JSON_TAPE_MAX_COUNT)
+        {
+            pairs_count = 0;
+            for (Json_Ref pair = json_tape_first(pairs_array); !json_tape_at_end(pair); pair = json_tape_next(pair))
+                ++pairs_count;
+        }
+        Haversine_Pair *pairs = push_array(arena, Haversine_Pair, pairs_count);
+
+        u64 idx = 0;
+        for (Json_Ref pair = json_tape_first(pairs_array); !json_tape_at_end(pair); pair = json_tape_next(pair), ++idx)
+        {
+            assert(idx < pairs_count);
+            for (Json_Ref key = json_tape_first(pair); !json_tape_at_end(key); key = json_tape_next(json_tape_next(key)))
+            {
+                String name = json_tape_string(key);
+                f64 value = json_tape_number(json_tape_next(key));
+                if (name == "x0")
                 {
-                    pairs[idx].x0 = pair.values[i].number;
+                    pairs[idx].x0 = value;
                 }
-                else if (pair.strings[i] == "y0")
+                else if (name == "y0")
                 {
-                    pairs[idx].y0 = pair.values[i].number;
+                    pairs[idx].y0 = value;
                 }
-                else if (pair.strings[i] == "x1")
+                else if (name == "x1")
                 {
-                    pairs[idx].x1 = pair.values[i].number;
+                    pairs[idx].x1 = value;
                 }
-                else if (pair.strings[i] == "y1")
+                else if (name == "y1")
                 {
-                    pairs[idx].y1 = pair.values[i].number;
+                    pairs[idx].y1 = value;
                 }
                 else
                 {
@@ -109,57 +214,564 @@ get_haversine_sum_from_json(Json_Object object, Memory_Arena *arena)
             }
         }
 
-        for (u32 idx = 0; idx < pairs_count; ++idx)
+        result = parallel_haversine_sum_pairs(jobs, pairs, pairs_count, arena);
+    }
+    else
+    {
+        invalid_code_path;
+    }
+
+    return result;
+}
+
+// @NOTE: Reads the pairs with the on-demand cursor, so nothing is allocated and
+// each number is converted exactly once, right where it's used.
+static f64
+get_haversine_sum_from_json_cursor(Buffer source)
+{
+    time_bandwidth(__func__, source.size);
+    Haversine_Sum_Accumulator sum = {};
+
+    Json_Cursor cursor;
+    init_json_cursor(&cursor, source);
+
+    u32 root = json_cursor_enter_object(&cursor);
+    if (json_cursor_find_field(&cursor, root, "pairs"))
+    {
+        u32 pairs = json_cursor_enter_array(&cursor);
+        while (json_cursor_next_element(&cursor, pairs))
         {
-            Haversine_Pair pair = pairs[idx];
-            result += haversine(pair.x0, pair.y0, pair.x1, pair.y1);
+            Haversine_Pair pair = {};
+            u32 pair_object = json_cursor_enter_object(&cursor);
+
+            String key;
+            while (json_cursor_next_field(&cursor, pair_object, &key))
+            {
+                f64 value = json_cursor_number(&cursor);
+                if (key == "x0")
+                {
+                    pair.x0 = value;
+                }
+                else if (key == "y0")
+                {
+                    pair.y0 = value;
+                }
+                else if (key == "x1")
+                {
+                    pair.x1 = value;
+                }
+                else if (key == "y1")
+                {
+                    pair.y1 = value;
+                }
+                else
+                {
+                    invalid_code_path;
+                }
+            }
+
+            accumulate_haversine_sum(&sum, haversine(pair.x0, pair.y0, pair.x1, pair.y1));
+        }
+    }
+
+    if (!json_cursor_finish(&cursor))
+        invalid_code_path;
+
+    return finish_haversine_sum(&sum);
+}
+
+struct Pipeline_Options
+{
+    b32 use_mapped_input;
+    b32 prefault_input;
+    b32 use_scalar_tokenizer;
+    b32 use_tape_dom;
+    b32 use_direct_parser;
+    b32 use_cursor;
+    b32 use_streaming_input;
+    mmm stream_chunk_size;
+    u32 async_queue_depth;
+    Async_Io_Backend async_backend;
+    b32 use_binary_input;
+    u32 thread_count;               // 0: sum on the main thread only.
+    b32 pin_threads;
+    b32 use_large_pages;
+};
+
+static f64
+get_haversine_sum_from_columns(Haversine_Columns *columns, Job_System *jobs, Memory_Arena *arena)
+{
+    return parallel_haversine_sum_columns(jobs, columns->x0, columns->y0, columns->x1, columns->y1, columns->count, arena);
+}
+
+//
+// STREAMING
+// The pairs are summed straight from parser events, one chunk of the file at a
+// time, so neither the file nor any tokens are ever fully resident.
+//
+
+struct Haversine_Stream_Sum
+{
+    b32 in_pairs;
+    s32 key_index;
+    u32 seen_mask;
+    f64 coordinates[4];
+
+    u64 pair_count;
+    Haversine_Sum_Accumulator sum;
+    b32 error;
+};
+
+static void
+haversine_stream_event(void *user_data, Json_Event *event)
+{
+    Haversine_Stream_Sum *state = (Haversine_Stream_Sum *)user_data;
+    switch (event->type)
+    {
+        case Json_Event_Type_Key:
+        {
+            if (event->depth == 1)
+            {
+                state->in_pairs = (event->string == "pairs");
+            }
+            else if (event->depth == 3)
+            {
+                if      (event->string == "x0") state->key_index = 0;
+                else if (event->string == "y0") state->key_index = 1;
+                else if (event->string == "x1") state->key_index = 2;
+                else if (event->string == "y1") state->key_index = 3;
+                else                            state->key_index = -1;
+            }
+        } break;
+
+        case Json_Event_Type_Number:
+        {
+            if (state->in_pairs && event->depth == 3 && state->key_index >= 0)
+            {
+                state->coordinates[state->key_index] = event->number;
+                state->seen_mask |= (1 << state->key_index);
+            }
+        } break;
+
+        case Json_Event_Type_End_Object:
+        {
+            if (state->in_pairs && event->depth == 2)
+            {
+                if (state->seen_mask == 0xF)
+                {
+                    f64 *c = state->coordinates;
+                    accumulate_haversine_sum(&state->sum, haversine(c[0], c[1], c[2], c[3]));
+                    ++state->pair_count;
+                }
+                else
+                {
+                    state->error = true;
+                }
+                state->seen_mask = 0;
+            }
+        } break;
+
+        default: {} break;
+    }
+}
+
+internal f64
+get_haversine_sum_from_json_stream(const char *filename, Pipeline_Options *options)
+{
+    time_function();
+
+    Haversine_Stream_Sum state = {};
+    mmm chunk_size = options->stream_chunk_size;
+
+    Json_Stream stream;
+    init_json_stream(&stream, haversine_stream_event, &state);
+
+    b32 opened = false;
+    if (options->async_queue_depth)
+    {
+        Memory_Arena chunk_arena = {};
+        init_arena(&chunk_arena, chunk_size * (options->async_queue_depth + 2) + KB(64));
+
+        Async_Reader reader;
+        opened = open_async_reader(&reader, filename, chunk_size, options->async_queue_depth, options->async_backend, &chunk_arena);
+        if (opened)
+        {
+            b32 ok = true;
+            while (ok)
+            {
+                Buffer chunk = async_reader_next(&reader);
+                if (!chunk.size)
+                    break;
+
+                // @NOTE: Fed in slices, with a poll in between, so reads that
+                // finish while this chunk is parsed are seen when they do.
+                for (mmm offset = 0; ok && offset < chunk.size; offset += ASYNC_IO_POLL_SIZE)
+                {
+                    mmm slice_size = chunk.size - offset;
+                    if (slice_size > ASYNC_IO_POLL_SIZE)
+                        slice_size = ASYNC_IO_POLL_SIZE;
+                    ok = json_stream_feed(&stream, chunk.data + offset, slice_size);
+                    async_reader_poll(&reader);
+                }
+            }
+            close_async_reader(&reader);
+            record_async_reader_profile(&reader);
         }
     }
     else
+    {
+        Memory_Arena chunk_arena = {};
+        init_arena(&chunk_arena, chunk_size);
+        u8 *chunk = (u8 *)push_size(&chunk_arena, chunk_size);
+
+        FILE *file = fopen(filename, "rb");
+        opened = (file != 0);
+        if (opened)
+        {
+            for (;;)
+            {
+                mmm read_size = fread(chunk, 1, chunk_size, file);
+                if (!read_size || !json_stream_feed(&stream, chunk, read_size))
+                    break;
+            }
+            fclose(file);
+        }
+    }
+
+    if (opened)
+    {
+        if (!json_stream_finish(&stream) || state.error)
+            fprintf(stderr, "[ERROR]: %s is not a valid pairs file.\n", filename);
+    }
+    else
     {
         invalid_code_path;
     }
+    close_json_stream(&stream);
 
+    return finish_haversine_sum(&state.sum);
+}
+
+// The job system for --threads, or 0 without it. 'job_arena' is set up either
+// way, since the column sums keep their per-task partials on it.
+static Job_System *
+start_pipeline_jobs(Pipeline_Options *options, Job_System *job_system, Memory_Arena *job_arena)
+{
+    Job_System *result = 0;
+    init_arena(job_arena, options->thread_count * (sizeof(Job_Worker) + JOB_DEQUE_CAPACITY * sizeof(u32)) + JOB_DEQUE_CAPACITY * sizeof(f64) + KB(64));
+    if (options->thread_count)
+    {
+        init_job_system(job_system, options->thread_count, options->pin_threads, job_arena);
+        result = job_system;
+    }
     return result;
 }
 
-int main(void)
+//
+// BINARY
+// The .hvb file next to the json holds the same pairs as columns, so they're
+// summed straight out of the mapping with nothing to parse.
+//
+
+internal f64
+get_haversine_sum_from_binary_file(const char *json_filename, Pipeline_Options *options)
 {
-    begin_profile();
+    f64 haversine_sum = 0.0;
 
+    char filename[512];
+    get_haversine_binary_filename(json_filename, filename, sizeof(filename));
+
+    Buffer binary_file = {};
+    {
+        time_block("map_binary_file");
+        binary_file = map_entire_file(filename);
+    }
+
+    if (binary_file.data)
+    {
+        Haversine_Binary_Header header = {};
+        Haversine_Columns columns = {};
+        if (get_haversine_columns_from_binary(binary_file, &columns, &header))
+        {
+            b32 checksum_valid;
+            {
+                time_bandwidth("verify_binary_checksum", columns.count * Haversine_Field_Count * sizeof(f64));
+                checksum_valid = is_haversine_binary_checksum_valid(&header, &columns);
+            }
+
+            if (checksum_valid)
+            {
+                Memory_Arena job_arena = {};
+                Job_System job_system = {};
+                Job_System *jobs = start_pipeline_jobs(options, &job_system, &job_arena);
+
+                haversine_sum = get_haversine_sum_from_columns(&columns, jobs, &job_arena);
+
+                if (jobs)
+                    shutdown_job_system(jobs);
+            }
+            else
+            {
+                fprintf(stderr, "[ERROR]: %s failed its checksum.\n", filename);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "[ERROR]: %s is not a version %u pair file.\n", filename, HAVERSINE_BINARY_VERSION);
+        }
+
+        unmap_file(binary_file);
+    }
+    else
+    {
+        fprintf(stderr, "[ERROR]: Couldn't open %s (write it with haversine_generator --binary or haversine_converter).\n", filename);
+    }
+
+    return haversine_sum;
+}
+
+//
+// DOM
+//
+
+internal f64
+get_haversine_sum_from_json_file(const char *filename, Pipeline_Options *options)
+{
+    f64 haversine_sum = 0.0;
+
+    // @NOTE: With --large-pages the input goes in explicit large pages if
+    // there are any, and every arena asks for transparent ones. A mapped input
+    // stays in the page cache's own pages.
+    u32 arena_flags = (options->use_large_pages ? Arena_Flag_Large_Pages : 0);
     Memory_Arena file_arena = {};
-    init_arena(&file_arena, MB(500));
+    init_arena(&file_arena, MB(500), arena_flags);
+    if (file_arena.flags != arena_flags)
+        fprintf(stderr, "[WARNING]: Large pages are unavailable, using regular pages.\n");
+
+    Buffer json_file = {};
+    b32 json_file_is_mapped = false;
+    b32 json_file_is_large_pages = false;
+    if (options->use_mapped_input)
+    {
+        json_file = map_entire_file_for_tokenizer(filename, options->prefault_input);
+        json_file_is_mapped = (json_file.data != 0);
+    }
+    else if (options->use_large_pages)
+    {
+        json_file = read_entire_file_into_large_pages(filename);
+        json_file_is_large_pages = (json_file.data != 0);
+    }
+    if (!json_file.data)
+        json_file = read_entire_file_and_null_terminate(filename, &file_arena);
+
+    Memory_Arena job_arena = {};
+    Job_System job_system = {};
+    Job_System *jobs = start_pipeline_jobs(options, &job_system, &job_arena);
 
-    Buffer json_file = read_entire_file_and_null_terminate(haversine_json_filename, &file_arena);
     if (json_file.data)
     {
-        Memory_Arena token_arena = {};
-        Memory_Arena literal_arena = {};
-        Memory_Arena data_arena = {};
-        Memory_Arena haversine_arena = {};
+        Haversine_Columns columns = {};
+        Memory_Arena column_arena = {};
+        b32 parsed_without_tokens = false;
+        if (options->use_cursor)
+        {
+            haversine_sum = get_haversine_sum_from_json_cursor(json_file);
+            parsed_without_tokens = true;
+        }
+        else if (options->use_direct_parser)
+        {
+            mmm column_size = (json_file.size / HAVERSINE_MIN_PAIR_SIZE + 1) * Haversine_Field_Count * sizeof(f64);
+            init_arena(&column_arena, column_size, arena_flags);
+            if (jobs)
+                parsed_without_tokens = parse_haversine_columns_parallel(jobs, json_file, &column_arena, &columns);
+            else
+                parsed_without_tokens = parse_haversine_columns_direct(json_file, &column_arena, &columns);
+            if (parsed_without_tokens)
+                haversine_sum = get_haversine_sum_from_columns(&columns, jobs, &job_arena);
+            else
+                fprintf(stderr, "[WARNING]: Input doesn't match the pair schema, using the generic parser.\n");
+        }
 
-        init_arena(&token_arena, GB(1));
-        init_arena(&literal_arena, MB(50));
-        init_arena(&data_arena, GB(1));
-        init_arena(&haversine_arena, MB(50));
+        if (!parsed_without_tokens)
+        {
+            Memory_Arena token_arena = {};
+            Memory_Arena data_arena = {};
+            Memory_Arena haversine_arena = {};
 
-        tokenize(json_file, &token_arena, &literal_arena);
-        // DEBUG_print_tokens(&token_arena);
+            // @NOTE: Every byte could be its own token, plus the EOF token.
+            init_arena(&token_arena, (json_file.size + 1) * sizeof(Token), arena_flags);
+            init_arena(&haversine_arena, MB(50), arena_flags);
 
-        Json_Object root_object = parse_json(&token_arena, &data_arena);
-        f64 haversine_sum = get_haversine_sum_from_json(root_object, &haversine_arena);
+            if (options->use_scalar_tokenizer)
+                tokenize(json_file, &token_arena);
+            else
+                tokenize_structural(json_file, &token_arena);
+            // DEBUG_print_tokens(json_file, &token_arena);
 
-        Buffer answer_file = read_entire_file_and_null_terminate(haversine_answer_filename, &file_arena);
-        Stream answer_stream = {};
-        answer_stream.at = answer_file.data;
-        f64 expected_haversine_sum = json_get_number_from_stream(&answer_stream);
+            if (options->use_direct_parser || options->use_tape_dom)
+            {
+                // @NOTE: A token never takes more than two words of tape, plus the root word.
+                init_arena(&data_arena, ((token_arena.used / sizeof(Token)) * 2 + 1) * sizeof(u64), arena_flags);
+                Json_Tape tape = parse_json_tape(json_file, &token_arena, &data_arena);
+                if (options->use_direct_parser)
+                {
+                    get_haversine_columns_from_tape(&tape, &column_arena, &columns);
+                    haversine_sum = get_haversine_sum_from_columns(&columns, jobs, &job_arena);
+                }
+                else
+                {
+                    haversine_sum = get_haversine_sum_from_json_tape(&tape, jobs, &haversine_arena);
+                }
+            }
+            else
+            {
+                init_arena(&data_arena, GB(1), arena_flags);
+                Json_Key_Table keys = {};
+                Json_Object root_object = parse_json(json_file, &token_arena, &data_arena, &keys);
+                haversine_sum = get_haversine_sum_from_json(root_object, &keys, jobs, &haversine_arena);
+            }
+        }
 
-        printf("Expected: %.16f km\nActual  : %.16f km\nError   : %.16f km\n", expected_haversine_sum, haversine_sum, abs(haversine_sum - expected_haversine_sum));
+        if (json_file_is_mapped)
+            unmap_null_terminated_file(json_file);
+        if (json_file_is_large_pages)
+            free_large_page_file(json_file);
     }
     else
     {
         invalid_code_path;
     }
 
+    if (jobs)
+        shutdown_job_system(jobs);
+
+    return haversine_sum;
+}
+
+internal f64
+read_expected_haversine_sum(const char *filename)
+{
+    Memory_Arena answer_arena = {};
+    init_arena(&answer_arena, KB(4));
+
+    Buffer answer_file = read_entire_file_and_null_terminate(filename, &answer_arena);
+    Stream answer_stream = {};
+    answer_stream.at = answer_file.data;
+    f64 result = json_get_number_from_stream(&answer_stream);
+
+    return result;
+}
+
+static void
+print_usage(void)
+{
+    fprintf(stderr, "main [--mapped] [--prefault] [--scalar] [--tape] [--direct] [--cursor] [--stream [chunk_bytes]] [--async [queue_depth]] [--io-threads] [--binary] [--threads [count]] [--pin] [--large-pages]\n"
+                    "  --mapped     : tokenize straight from a read-only mapping of the json file.\n"
+                    "  --prefault   : like --mapped, but populate the whole mapping up front.\n"
+                    "  --scalar     : use the byte-at-a-time tokenizer instead of the SIMD structural scanner.\n"
+                    "  --tape       : build the flat tape DOM instead of the Json_Object tree.\n"
+                    "  --direct     : decode straight into pair columns, falling back to the tape if the schema doesn't match.\n"
+                    "                 The pairs are then summed with the SIMD haversine_batch kernels.\n"
+                    "  --cursor     : sum the pairs through the on-demand cursor, without tokens or a DOM.\n"
+                    "  --stream     : parse the file in fixed-size chunks (default 1MB) with constant memory.\n"
+                    "  --async      : like --stream, but keep queue_depth (default 4) chunk reads in flight.\n"
+                    "  --io-threads : make --async use the thread pool even when io_uring is available.\n"
+                    "  --binary     : sum the pairs from the .hvb columns next to the json, with no parsing.\n"
+                    "  --threads    : sum the pairs on a work-stealing pool of count (default: all cores) workers.\n"
+                    "                 With --direct the file is also decoded in parallel, one byte range per worker.\n"
+                    "                 The sum is bit-identical for any count.\n"
+                    "  --pin        : with --threads, pin worker i to core i.\n"
+                    "  --large-pages: back the input and the arenas with 2MB pages where the OS allows it.\n");
+}
+
+int main(int argc, char **args)
+{
+    Pipeline_Options options = {};
+    options.stream_chunk_size = MB(1);
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        if (string_equal(args[arg_index], "--mapped"))
+        {
+            options.use_mapped_input = true;
+        }
+        else if (string_equal(args[arg_index], "--prefault"))
+        {
+            options.use_mapped_input = true;
+            options.prefault_input = true;
+        }
+        else if (string_equal(args[arg_index], "--scalar"))
+        {
+            options.use_scalar_tokenizer = true;
+        }
+        else if (string_equal(args[arg_index], "--tape"))
+        {
+            options.use_tape_dom = true;
+        }
+        else if (string_equal(args[arg_index], "--direct"))
+        {
+            options.use_direct_parser = true;
+        }
+        else if (string_equal(args[arg_index], "--cursor"))
+        {
+            options.use_cursor = true;
+        }
+        else if (string_equal(args[arg_index], "--stream"))
+        {
+            options.use_streaming_input = true;
+            if (arg_index + 1 < argc && atoll(args[arg_index + 1]) > 0)
+                options.stream_chunk_size = (mmm)atoll(args[++arg_index]);
+        }
+        else if (string_equal(args[arg_index], "--async"))
+        {
+            options.use_streaming_input = true;
+            options.async_queue_depth = 4;
+            if (arg_index + 1 < argc && atoi(args[arg_index + 1]) > 0)
+                options.async_queue_depth = (u32)atoi(args[++arg_index]);
+        }
+        else if (string_equal(args[arg_index], "--io-threads"))
+        {
+            options.async_backend = Async_Io_Backend_Threads;
+        }
+        else if (string_equal(args[arg_index], "--binary"))
+        {
+            options.use_binary_input = true;
+        }
+        else if (string_equal(args[arg_index], "--threads"))
+        {
+            options.thread_count = get_logical_core_count();
+            if (arg_index + 1 < argc && atoi(args[arg_index + 1]) > 0)
+                options.thread_count = (u32)atoi(args[++arg_index]);
+        }
+        else if (string_equal(args[arg_index], "--pin"))
+        {
+            options.pin_threads = true;
+        }
+        else if (string_equal(args[arg_index], "--large-pages"))
+        {
+            options.use_large_pages = true;
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    begin_profile();
+
+    f64 haversine_sum = 0.0;
+    if (options.use_binary_input)
+        haversine_sum = get_haversine_sum_from_binary_file(haversine_json_filename, &options);
+    else if (options.use_streaming_input)
+        haversine_sum = get_haversine_sum_from_json_stream(haversine_json_filename, &options);
+    else
+        haversine_sum = get_haversine_sum_from_json_file(haversine_json_filename, &options);
+
+    f64 expected_haversine_sum = read_expected_haversine_sum(haversine_answer_filename);
+
+    printf("Expected: %.16f km\nActual  : %.16f km\nError   : %.16f km\n", expected_haversine_sum, haversine_sum, fabs(haversine_sum - expected_haversine_sum));
+    printf("Peak memory: %.2fmb\n", (f64)get_peak_memory_usage() / (f64)MB(1));
+
     end_and_print_profile();
 }
@@ -0,0 +1,183 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core.h"
+#include "platform.cpp"
+#include "haversine_shared.cpp"
+#include "repetition_tester.cpp"
+
+//
+// Accuracy and speed of haversine_math.cpp against libm. Every function is
+// swept over the domain haversine() feeds it, then timed on random inputs
+// from that domain.
+//
+//     math_test [samples] [seconds_per_test]
+//
+
+typedef f64 Math_Function(f64 x);
+
+// @NOTE: libm's functions are overloaded in C++, so they're wrapped to get
+// something with a single address.
+static f64 libm_sin(f64 x)  { return sin(x);  }
+static f64 libm_cos(f64 x)  { return cos(x);  }
+static f64 libm_asin(f64 x) { return asin(x); }
+static f64 libm_sqrt(f64 x) { return sqrt(x); }
+
+struct Math_Function_Entry
+{
+    char const *name;
+    Math_Function *func;
+    Math_Function *reference;
+    f64 min_input;
+    f64 max_input;
+};
+
+struct Math_Error
+{
+    f64 max_abs_error;
+    f64 max_ulp_error;
+    f64 worst_input;        // Where max_ulp_error happened.
+};
+
+// Distance from 'value' to the next double away from zero.
+static f64
+ulp_of(f64 value)
+{
+    value = fabs(value);
+    return (nextafter(value, INFINITY) - value);
+}
+
+static Math_Error
+sweep_math_function(Math_Function_Entry *entry, u64 sample_count)
+{
+    Math_Error result = {};
+
+    f64 step = (entry->max_input - entry->min_input) / (f64)(sample_count - 1);
+    for (u64 idx = 0; idx < sample_count; ++idx)
+    {
+        f64 x = (idx == sample_count - 1) ? entry->max_input : entry->min_input + step * (f64)idx;
+        f64 expected = entry->reference(x);
+        f64 error = fabs(entry->func(x) - expected);
+        f64 ulp_error = error / ulp_of(expected);
+
+        if (error > result.max_abs_error)
+            result.max_abs_error = error;
+        if (ulp_error > result.max_ulp_error)
+        {
+            result.max_ulp_error = ulp_error;
+            result.worst_input = x;
+        }
+    }
+
+    return result;
+}
+
+static void
+time_math_function(Repetition_Tester *tester, Math_Function *func, f64 *inputs, u64 input_count)
+{
+    while (is_testing(tester))
+    {
+        f64 sum = 0.0;
+
+        begin_time(tester);
+        for (u64 idx = 0; idx < input_count; ++idx)
+            sum += func(inputs[idx]);
+        end_time(tester);
+
+        count_bytes(tester, input_count * sizeof(f64));
+
+        volatile f64 sink = sum;
+    }
+}
+
+static f64
+calls_per_second(Repetition_Tester *tester, u64 input_count, u64 cpu_timer_frequency)
+{
+    f64 min_seconds = seconds_from_cpu_time((f64)tester->results.min.e[Repetition_Value_Type_CPU_Timer], cpu_timer_frequency);
+    return (min_seconds > 0.0) ? (f64)input_count / min_seconds : 0.0;
+}
+
+int main(int argc, char **args)
+{
+    u64 sample_count = 10'000'000;
+    u32 seconds_to_try = 3;
+    if (argc > 1)
+        sample_count = (u64)atoll(args[1]);
+    if (argc > 2)
+        seconds_to_try = (u32)atoi(args[2]);
+    if (sample_count < 2)
+        sample_count = 2;
+
+    f64 pi = 3.14159265358979323846;
+    Math_Function_Entry entries[] =
+    {
+        // sin sees half a lat/lon delta, cos a latitude, asin and sqrt the haversine term 'a'.
+        {"sin",  math_sin,  libm_sin,  -pi,        pi},
+        {"cos",  math_cos,  libm_cos,  -0.5 * pi,  0.5 * pi},
+        {"asin", math_asin, libm_asin, 0.0,        1.0},
+        {"sqrt", math_sqrt, libm_sqrt, 0.0,        1.0},
+    };
+
+    u64 input_count = 1'000'000;
+    f64 *inputs = (f64 *)malloc(input_count * sizeof(f64));
+    u64 cpu_timer_frequency = get_cpu_timer_frequency();
+
+    Math_Error errors[array_count(entries)];
+    f64 ours_per_second[array_count(entries)];
+    f64 libm_per_second[array_count(entries)];
+
+    for (u32 entry_index = 0; entry_index < array_count(entries); ++entry_index)
+    {
+        Math_Function_Entry *entry = entries + entry_index;
+
+        printf("\n--- %s: sweeping %llu samples over [%g, %g] ---\n", entry->name, sample_count, entry->min_input, entry->max_input);
+        errors[entry_index] = sweep_math_function(entry, sample_count);
+
+        for (u64 idx = 0; idx < input_count; ++idx)
+            inputs[idx] = entry->min_input + (entry->max_input - entry->min_input) * (f64)rand() / (f64)RAND_MAX;
+
+        Repetition_Tester ours = {};
+        printf("\n--- math_%s ---\n", entry->name);
+        new_test_wave(&ours, input_count * sizeof(f64), cpu_timer_frequency, seconds_to_try);
+        time_math_function(&ours, entry->func, inputs, input_count);
+        ours_per_second[entry_index] = calls_per_second(&ours, input_count, cpu_timer_frequency);
+
+        Repetition_Tester libm = {};
+        printf("\n--- libm %s ---\n", entry->name);
+        new_test_wave(&libm, input_count * sizeof(f64), cpu_timer_frequency, seconds_to_try);
+        time_math_function(&libm, entry->reference, inputs, input_count);
+        libm_per_second[entry_index] = calls_per_second(&libm, input_count, cpu_timer_frequency);
+    }
+
+    printf("\n%-6s %24s %14s %12s %18s %14s %14s %9s\n",
+           "func", "domain", "max abs err", "max ulp", "worst x", "M calls/s", "libm M/s", "speedup");
+    for (u32 entry_index = 0; entry_index < array_count(entries); ++entry_index)
+    {
+        Math_Function_Entry *entry = entries + entry_index;
+        Math_Error *error = errors + entry_index;
+
+        char domain[64];
+        snprintf(domain, sizeof(domain), "[%.6f, %.6f]", entry->min_input, entry->max_input);
+        f64 speedup = (libm_per_second[entry_index] > 0.0) ? ours_per_second[entry_index] / libm_per_second[entry_index] : 0.0;
+        printf("%-6s %24s %14.3e %12.3f %18.12f %14.1f %14.1f %8.2fx\n",
+               entry->name, domain, error->max_abs_error, error->max_ulp_error, error->worst_input,
+               ours_per_second[entry_index] / 1e6, libm_per_second[entry_index] / 1e6, speedup);
+    }
+
+    free(inputs);
+    return 0;
+}
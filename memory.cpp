@@ -11,29 +11,228 @@
 
 
 
+//
+// Arenas reserve address space up front and commit it as pushes reach it, so
+// a generous size costs nothing until it's used and there's no malloc+memset
+// of the whole thing at startup. Committed pages come from the OS zeroed;
+// memory handed out again after 'used' is rolled back isn't, which is what
+// push_size_zero() is for.
+//
+// An arena whose base and size are filled in by hand (a slice of another
+// arena, say) has nothing reserved and never grows.
+//
+// @NOTE: Growing only ever commits more of the reservation; the arena never
+// moves, since everything pushed onto it is pointed at in place (and token
+// and tape arrays are walked as one block). So a push that doesn't fit in
+// what's left of the reservation, or of a hand-made arena, or that the OS
+// won't commit, returns 0 and leaves the arena as it was. The reservation is
+// at least ARENA_MIN_RESERVE_SIZE, so only hand-made arenas run out in
+// practice, and their users check.
+//
+// Arena_Flag_Large_Pages asks for memory backed by large (2MB) pages, which
+// cuts the TLB misses and page faults of walking through big token and DOM
+// arrays. It's a request: where the OS can't do it the arena gets regular
+// pages, and its flags say which it got.
+//
+// Nothing is ever freed on its own. Memory goes back by rolling 'used' back:
+// reset_arena() for the whole arena, or a Temporary_Memory scope for
+// whatever was pushed since it began.
+//
+
+#define ARENA_MIN_RESERVE_SIZE  GB(64)
+#define ARENA_COMMIT_SIZE       MB(1)
+
+enum Arena_Flags
+{
+    Arena_Flag_Large_Pages = 0x1,
+};
+
 struct Memory_Arena
 {
     u8 *base;
     mmm size;
     mmm used;
+
+    mmm committed;
+    mmm reserved;
+    mmm commit_size;
+    u32 flags;
 };
 
+static mmm
+align_arena_size(mmm size, mmm alignment)
+{
+    return ((size + alignment - 1) & ~(alignment - 1));
+}
+
+// 'size' is the least the arena can grow to; it can always get that far
+// without moving.
+static void
+init_arena(Memory_Arena *arena, mmm size, u32 flags = 0)
+{
+    *arena = {};
+
+    mmm min_size = (size > ARENA_MIN_RESERVE_SIZE ? size : ARENA_MIN_RESERVE_SIZE);
+    mmm reserve_size = 0;
+    if (flags & Arena_Flag_Large_Pages)
+    {
+        // @NOTE: Commits have to cover whole large pages too, or the last one
+        // would be left partly inaccessible and couldn't be a large page.
+        mmm large_page_size = get_large_page_size();
+        if (large_page_size)
+        {
+            reserve_size = align_arena_size(min_size, large_page_size);
+            arena->base = (u8 *)reserve_large_page_memory(reserve_size);
+            arena->commit_size = large_page_size;
+            arena->flags = Arena_Flag_Large_Pages;
+        }
+    }
+
+    if (!arena->base)
+    {
+        reserve_size = align_arena_size(min_size, ARENA_COMMIT_SIZE);
+        arena->base = (u8 *)reserve_memory(reserve_size);
+        arena->commit_size = ARENA_COMMIT_SIZE;
+        arena->flags = 0;
+    }
+
+    assert(arena->base);
+    arena->size = reserve_size;
+    arena->reserved = reserve_size;
+}
+
 static void
-init_arena(Memory_Arena *arena, mmm size)
+release_arena(Memory_Arena *arena)
+{
+    if (arena->reserved)
+        release_memory(arena->base, arena->reserved);
+    *arena = {};
+}
+
+// Keeps what's committed, so refilling the arena costs no page faults.
+static void
+reset_arena(Memory_Arena *arena)
 {
-    arena->base = (u8 *)malloc(size);
-    arena->size = size;
     arena->used = 0;
-    memset(arena->base, 0, size);
 }
 
 #define push_struct(ARENA, STRUCT) (STRUCT *)push_size(ARENA, sizeof(STRUCT))
-#define push_array(ARENA, STRUCT, COUNT) (STRUCT *)push_size(ARENA, sizeof(STRUCT)*COUNT)
+#define push_array(ARENA, STRUCT, COUNT) (STRUCT *)push_size(ARENA, sizeof(STRUCT)*(COUNT))
 static void *
 push_size(Memory_Arena *arena, mmm size)
 {
-    assert(arena->used + size <= arena->size);
+    if (size > arena->size - arena->used)
+        return 0;
+
+    mmm used = arena->used + size;
+    if (arena->reserved && used > arena->committed)
+    {
+        mmm committed = align_arena_size(used, arena->commit_size);
+        if (committed > arena->reserved)
+            committed = arena->reserved;
+        if (!commit_memory(arena->base + arena->committed, committed - arena->committed))
+            return 0;
+        arena->committed = committed;
+    }
+
     void *result = (arena->base + arena->used);
-    arena->used += size;
+    arena->used = used;
+    return result;
+}
+
+#define push_struct_zero(ARENA, STRUCT) (STRUCT *)push_size_zero(ARENA, sizeof(STRUCT))
+#define push_array_zero(ARENA, STRUCT, COUNT) (STRUCT *)push_size_zero(ARENA, sizeof(STRUCT)*(COUNT))
+static void *
+push_size_zero(Memory_Arena *arena, mmm size)
+{
+    void *result = push_size(arena, size);
+    if (result)
+        memset(result, 0, size);
+    return result;
+}
+
+#define push_array_aligned(ARENA, STRUCT, COUNT, ALIGNMENT) (STRUCT *)push_size_aligned(ARENA, sizeof(STRUCT)*(COUNT), ALIGNMENT)
+// 'alignment' is a power of two, relative to the address (not the offset in
+// the arena).
+static void *
+push_size_aligned(Memory_Arena *arena, mmm size, mmm alignment)
+{
+    umm at = (umm)(arena->base + arena->used);
+    mmm padding = (mmm)(align_arena_size(at, alignment) - at);
+    u8 *result = (u8 *)push_size(arena, padding + size);
+    return (result ? result + padding : 0);
+}
+
+//
+// Temporary memory
+//
+
+struct Temporary_Memory
+{
+    Memory_Arena *arena;
+    mmm used;
+};
+
+static Temporary_Memory
+begin_temporary_memory(Memory_Arena *arena)
+{
+    Temporary_Memory result = {};
+    result.arena = arena;
+    result.used = arena->used;
+    return result;
+}
+
+// Pops everything pushed since the scope began. Scopes on the same arena end
+// in the reverse order they began.
+static void
+end_temporary_memory(Temporary_Memory temp)
+{
+    assert(temp.arena->used >= temp.used);
+    temp.arena->used = temp.used;
+}
+
+//
+// Scratch arenas
+//
+// Every thread has two, made the first time it asks. A function that needs
+// memory only while it runs takes a Temporary_Memory on one of them instead
+// of pushing onto the arena its caller gave it.
+//
+// @NOTE: 'conflict' is the arena the result will be pushed onto, if that can
+// be a scratch arena itself (a caller's scratch handed down as the output
+// arena). The other one is returned, so popping the scratch never pops the
+// output with it.
+//
+
+#define SCRATCH_ARENA_COUNT 2
+
+static thread_local Memory_Arena g_scratch_arenas[SCRATCH_ARENA_COUNT];
+
+static Memory_Arena *
+get_scratch_arena(Memory_Arena *conflict)
+{
+    Memory_Arena *result = 0;
+    for (u32 index = 0; index < SCRATCH_ARENA_COUNT; ++index)
+    {
+        Memory_Arena *scratch = g_scratch_arenas + index;
+        if (scratch != conflict)
+        {
+            result = scratch;
+            break;
+        }
+    }
+
+    if (!result->base)
+        init_arena(result, ARENA_MIN_RESERVE_SIZE);
     return result;
 }
+
+// Gives back this thread's scratch reservations and everything committed in
+// them. Threads other than the main one call it on their way out; nothing
+// else would, and their arenas would outlive them.
+static void
+release_scratch_arenas(void)
+{
+    for (u32 index = 0; index < SCRATCH_ARENA_COUNT; ++index)
+        release_arena(g_scratch_arenas + index);
+}
@@ -10,8 +10,41 @@
 
 #include "core.h"
 
+enum Pmc_Counter
+{
+    Pmc_Counter_Cycles,
+    Pmc_Counter_Instructions,
+    Pmc_Counter_LLC_Misses,
+    Pmc_Counter_Branch_Misses,
+    Pmc_Counter_Page_Faults,
+    Pmc_Counter_DTLB_Misses,
+
+    Pmc_Counter_Count,
+};
+
+struct Pmc_Values
+{
+    u64 counts[Pmc_Counter_Count];
+};
+
+struct Pmc_Group
+{
+    int leader;
+    int fds[Pmc_Counter_Count];
+    u32 slot_count;
+    u32 slots[Pmc_Counter_Count];
+    b32 available[Pmc_Counter_Count];
+};
+
+typedef void Thread_Proc(void *param);
+
 #ifdef _MSC_VER
   #include <windows.h>
+  #include <intrin.h>
+  #include <psapi.h>
+
+  #pragma comment(lib, "psapi.lib")
+  #pragma comment(lib, "advapi32.lib")
   
   static u64
   get_os_timer_frequency(void)
@@ -28,8 +61,929 @@
       QueryPerformanceCounter(&value);
       return value.QuadPart;
   }
+
+  static void
+  cpuid(u32 leaf, u32 subleaf, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx)
+  {
+      int regs[4];
+      __cpuidex(regs, (int)leaf, (int)subleaf);
+      *eax = (u32)regs[0];
+      *ebx = (u32)regs[1];
+      *ecx = (u32)regs[2];
+      *edx = (u32)regs[3];
+  }
+
+  static u64
+  read_xcr0(void)
+  {
+      return _xgetbv(0);
+  }
+
+  static u64
+  get_tsc_frequency_from_os(void)
+  {
+      // @NOTE: Windows doesn't expose the TSC frequency directly.
+      return 0;
+  }
+
+  // @NOTE: TEMP is under the user's profile, so nobody else can write there.
+  static const char *
+  get_cache_directory(void)
+  {
+      return getenv("TEMP");
+  }
+
+  // Boot time to the minute, as a stand-in for a boot id. Jitter across a
+  // minute boundary (or a clock change) only makes it look like a new boot.
+  static b32
+  get_boot_id(char *dest, mmm dest_size)
+  {
+      FILETIME now;
+      GetSystemTimeAsFileTime(&now);
+      u64 now_seconds = (((u64)now.dwHighDateTime << 32) | now.dwLowDateTime) / 10000000;
+      u64 boot_minute = (now_seconds - GetTickCount64() / 1000) / 60;
+      snprintf(dest, dest_size, "%llu", (unsigned long long)boot_minute);
+      return true;
+  }
+
+  static mmm
+  get_page_size(void)
+  {
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return (mmm)info.dwPageSize;
+  }
+
+  static u64
+  read_os_page_fault_count(void)
+  {
+      PROCESS_MEMORY_COUNTERS_EX counters = {};
+      counters.cb = sizeof(counters);
+      GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS *)&counters, sizeof(counters));
+      return counters.PageFaultCount;
+  }
+
+  static mmm
+  get_peak_memory_usage(void)
+  {
+      PROCESS_MEMORY_COUNTERS counters = {};
+      counters.cb = sizeof(counters);
+      GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+      return (mmm)counters.PeakWorkingSetSize;
+  }
+
+  // Address space only: nothing is backed until commit_memory().
+  static void *
+  reserve_memory(mmm size)
+  {
+      return VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+  }
+
+  static b32
+  commit_memory(void *base, mmm size)
+  {
+      return (VirtualAlloc(base, size, MEM_COMMIT, PAGE_READWRITE) != 0);
+  }
+
+  static void
+  release_memory(void *base, mmm size)
+  {
+      VirtualFree(base, 0, MEM_RELEASE);
+  }
+
+  //
+  // Large pages
+  //
+
+  static mmm
+  get_large_page_size(void)
+  {
+      return (mmm)GetLargePageMinimum();
+  }
+
+  // @NOTE: Windows only hands out large pages committed, all at once, so
+  // there's nothing to reserve and grow into. Arenas asking for large pages
+  // fall back to regular ones.
+  static void *
+  reserve_large_page_memory(mmm size)
+  {
+      return 0;
+  }
+
+  // The process needs SeLockMemoryPrivilege for MEM_LARGE_PAGES, and it has
+  // to be switched on in the token even when the account holds it.
+  static b32
+  enable_large_page_privilege(void)
+  {
+      b32 result = false;
+
+      HANDLE token;
+      if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token))
+      {
+          TOKEN_PRIVILEGES privileges = {};
+          privileges.PrivilegeCount = 1;
+          privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+          if (LookupPrivilegeValueA(0, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid))
+          {
+              AdjustTokenPrivileges(token, FALSE, &privileges, 0, 0, 0);
+              result = (GetLastError() == ERROR_SUCCESS);
+          }
+          CloseHandle(token);
+      }
+
+      return result;
+  }
+
+  // Committed large pages, or 0 if they aren't available. 'size' is a
+  // multiple of get_large_page_size().
+  static void *
+  allocate_large_pages(mmm size)
+  {
+      void *result = 0;
+      if (enable_large_page_privilege())
+          result = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+      return result;
+  }
+
+  static void
+  free_large_pages(void *base, mmm size)
+  {
+      VirtualFree(base, 0, MEM_RELEASE);
+  }
+
+  static u32
+  get_logical_core_count(void)
+  {
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return (u32)info.dwNumberOfProcessors;
+  }
+
+  static b32
+  pin_current_thread_to_core(u32 core_index)
+  {
+      DWORD_PTR mask = ((DWORD_PTR)1 << core_index);
+      b32 result = (SetThreadAffinityMask(GetCurrentThread(), mask) != 0);
+      return result;
+  }
+
+  // @NOTE: The view keeps the file alive, so both handles are closed right away
+  // and unmapping only needs the base address.
+  static Buffer
+  map_entire_file(const char *filename)
+  {
+      Buffer result = {};
+
+      HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+      if (file != INVALID_HANDLE_VALUE)
+      {
+          LARGE_INTEGER file_size;
+          if (GetFileSizeEx(file, &file_size) && file_size.QuadPart)
+          {
+              HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+              if (mapping)
+              {
+                  result.data = (u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                  if (result.data)
+                      result.size = (mmm)file_size.QuadPart;
+                  CloseHandle(mapping);
+              }
+          }
+          CloseHandle(file);
+      }
+
+      return result;
+  }
+
+  static void
+  unmap_file(Buffer file)
+  {
+      if (file.data)
+          UnmapViewOfFile(file.data);
+  }
+
+  // @NOTE: The OS zero-fills the rest of the last page, which gives us the
+  // terminator for free. A file that ends exactly on a page boundary would need
+  // a placeholder mapping to get the extra zero page, so we return nothing and
+  // let the caller fall back to reading the file.
+  static Buffer
+  map_entire_file_and_null_terminate(const char *filename, b32 prefault)
+  {
+      Buffer result = map_entire_file(filename);
+      if (result.data && (result.size % get_page_size()) == 0)
+      {
+          unmap_file(result);
+          result = Buffer{};
+      }
+
+      if (result.data)
+      {
+          WIN32_MEMORY_RANGE_ENTRY range = {result.data, result.size};
+          if (prefault)
+              PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+      }
+
+      return result;
+  }
+
+  static void
+  unmap_null_terminated_file(Buffer file)
+  {
+      unmap_file(file);
+  }
+
+  // @NOTE: Reading PMCs on Windows requires ETW with admin rights, so the
+  // counters are simply reported as unavailable.
+  static b32
+  open_pmc_group(Pmc_Group *group)
+  {
+      *group = {};
+      return false;
+  }
+
+  static void
+  read_pmc_group(Pmc_Group *group, Pmc_Values *values)
+  {
+      *values = {};
+  }
+  //
+  // Threads and synchronization
+  //
+
+  struct Platform_Thread
+  {
+      HANDLE handle;
+      Thread_Proc *proc;
+      void *param;
+  };
+
+  struct Platform_Mutex
+  {
+      SRWLOCK lock;
+  };
+
+  struct Platform_Condition
+  {
+      CONDITION_VARIABLE variable;
+  };
+
+  static DWORD WINAPI
+  win32_thread_trampoline(LPVOID param)
+  {
+      Platform_Thread *thread = (Platform_Thread *)param;
+      thread->proc(thread->param);
+      return 0;
+  }
+
+  // @NOTE: 'thread' must stay alive until join_thread(), the trampoline reads it.
+  static b32
+  create_thread(Platform_Thread *thread, Thread_Proc *proc, void *param)
+  {
+      thread->proc = proc;
+      thread->param = param;
+      thread->handle = CreateThread(0, 0, win32_thread_trampoline, thread, 0, 0);
+      return (thread->handle != 0);
+  }
+
+  static void
+  join_thread(Platform_Thread *thread)
+  {
+      WaitForSingleObject(thread->handle, INFINITE);
+      CloseHandle(thread->handle);
+      thread->handle = 0;
+  }
+
+  static void init_mutex(Platform_Mutex *mutex)    { InitializeSRWLock(&mutex->lock); }
+  static void destroy_mutex(Platform_Mutex *mutex) {}
+  static void lock_mutex(Platform_Mutex *mutex)    { AcquireSRWLockExclusive(&mutex->lock); }
+  static void unlock_mutex(Platform_Mutex *mutex)  { ReleaseSRWLockExclusive(&mutex->lock); }
+
+  static void init_condition(Platform_Condition *condition)      { InitializeConditionVariable(&condition->variable); }
+  static void destroy_condition(Platform_Condition *condition)   {}
+  static void signal_condition(Platform_Condition *condition)    { WakeConditionVariable(&condition->variable); }
+  static void broadcast_condition(Platform_Condition *condition) { WakeAllConditionVariable(&condition->variable); }
+
+  static void
+  wait_condition(Platform_Condition *condition, Platform_Mutex *mutex)
+  {
+      SleepConditionVariableSRW(&condition->variable, &mutex->lock, INFINITE, 0);
+  }
+
+  static void yield_thread(void) { SwitchToThread(); }
+
+  // @NOTE: The Interlocked functions are full barriers. Plain loads and stores
+  // are already acquire/release on x64; the compiler barrier keeps MSVC from
+  // moving other accesses across them.
+  static s64
+  atomic_load_s64(volatile s64 *value)
+  {
+      s64 result = *value;
+      _ReadWriteBarrier();
+      return result;
+  }
+
+  static void
+  atomic_store_s64(volatile s64 *value, s64 new_value)
+  {
+      _ReadWriteBarrier();
+      *value = new_value;
+  }
+
+  static s64
+  atomic_add_s64(volatile s64 *value, s64 addend)
+  {
+      return (_InterlockedExchangeAdd64(value, addend) + addend);
+  }
+
+  static b32
+  atomic_compare_exchange_s64(volatile s64 *value, s64 expected, s64 new_value)
+  {
+      return (_InterlockedCompareExchange64(value, new_value, expected) == expected);
+  }
+
+  static void full_memory_barrier(void) { MemoryBarrier(); }
+
+  //
+  // Positional file reads
+  //
+
+  struct Platform_File
+  {
+      HANDLE handle;
+  };
+
+  static b32
+  open_file_for_reading(Platform_File *file, const char *filename)
+  {
+      file->handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+      return (file->handle != INVALID_HANDLE_VALUE);
+  }
+
+  static u64
+  get_file_size(Platform_File *file)
+  {
+      LARGE_INTEGER size = {};
+      GetFileSizeEx(file->handle, &size);
+      return (u64)size.QuadPart;
+  }
+
+  // @NOTE: Safe to call from several threads at once on the same file.
+  static mmm
+  read_file_at(Platform_File *file, u64 offset, void *dest, mmm size)
+  {
+      mmm result = 0;
+      while (result < size)
+      {
+          OVERLAPPED overlapped = {};
+          overlapped.Offset = (DWORD)(offset + result);
+          overlapped.OffsetHigh = (DWORD)((offset + result) >> 32);
+
+          mmm remaining = size - result;
+          DWORD read_size = (DWORD)((remaining > MB(256)) ? MB(256) : remaining);
+          DWORD bytes_read = 0;
+          if (!ReadFile(file->handle, (u8 *)dest + result, read_size, &bytes_read, &overlapped) || !bytes_read)
+              break;
+          result += bytes_read;
+      }
+      return result;
+  }
+
+  static void
+  close_file(Platform_File *file)
+  {
+      CloseHandle(file->handle);
+  }
+#elif defined(__linux__)
+  #include <x86intrin.h>
+  #include <cpuid.h>
+  #include <time.h>
+  #include <sched.h>
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/syscall.h>
+  #include <sys/resource.h>
+  #include <linux/perf_event.h>
+  #include <pthread.h>
+
+  static u64
+  get_os_timer_frequency(void)
+  {
+      return 1'000'000'000;
+  }
+
+  static u64
+  read_os_timer(void)
+  {
+      struct timespec value;
+      clock_gettime(CLOCK_MONOTONIC, &value);
+      return (u64)value.tv_sec * get_os_timer_frequency() + (u64)value.tv_nsec;
+  }
+
+  static void
+  cpuid(u32 leaf, u32 subleaf, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx)
+  {
+      __cpuid_count(leaf, subleaf, *eax, *ebx, *ecx, *edx);
+  }
+
+  // @NOTE: Inline asm so the file doesn't need -mxsave for _xgetbv.
+  static u64
+  read_xcr0(void)
+  {
+      u32 eax, edx;
+      __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      return ((u64)edx << 32) | eax;
+  }
+
+  // @NOTE: Some kernels export the calibrated TSC frequency in sysfs. Otherwise
+  // the perf user page carries the TSC -> ns conversion the kernel itself uses,
+  // which works even when hardware counters aren't accessible.
+  static u64
+  get_tsc_frequency_from_os(void)
+  {
+      u64 result = 0;
+
+      int fd = open("/sys/devices/system/cpu/cpu0/tsc_freq_khz", O_RDONLY);
+      if (fd >= 0)
+      {
+          char text[32] = {};
+          if (read(fd, text, sizeof(text) - 1) > 0)
+              result = strtoull(text, 0, 10) * 1000;
+          close(fd);
+      }
+
+      if (!result)
+      {
+          struct perf_event_attr attr = {};
+          attr.size = sizeof(attr);
+          attr.type = PERF_TYPE_SOFTWARE;
+          attr.config = PERF_COUNT_SW_DUMMY;
+          attr.exclude_kernel = 1;
+
+          int perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+          if (perf_fd >= 0)
+          {
+              void *page = mmap(0, (mmm)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, perf_fd, 0);
+              if (page != MAP_FAILED)
+              {
+                  struct perf_event_mmap_page *info = (struct perf_event_mmap_page *)page;
+                  if (info->cap_user_time && info->time_mult)
+                      result = ((u64)1'000'000'000 << info->time_shift) / info->time_mult;
+                  munmap(page, (mmm)sysconf(_SC_PAGESIZE));
+              }
+              close(perf_fd);
+          }
+      }
+
+      return result;
+  }
+
+  // @NOTE: XDG_RUNTIME_DIR is private to the user and emptied when they log
+  // out. There's no fallback to /tmp, which other users (and containers
+  // sharing it) can write to.
+  static const char *
+  get_cache_directory(void)
+  {
+      return getenv("XDG_RUNTIME_DIR");
+  }
+
+  static b32
+  get_boot_id(char *dest, mmm dest_size)
+  {
+      b32 result = false;
+
+      int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY);
+      if (fd >= 0)
+      {
+          ssize_t size = read(fd, dest, dest_size - 1);
+          if (size > 0)
+          {
+              while (size && (dest[size - 1] == '\n'))
+                  --size;
+              dest[size] = 0;
+              result = (size > 0);
+          }
+          close(fd);
+      }
+      return result;
+  }
+
+  static mmm
+  get_page_size(void)
+  {
+      return (mmm)sysconf(_SC_PAGESIZE);
+  }
+
+  static u64
+  read_os_page_fault_count(void)
+  {
+      struct rusage usage;
+      getrusage(RUSAGE_SELF, &usage);
+      return (u64)(usage.ru_minflt + usage.ru_majflt);
+  }
+
+  static mmm
+  get_peak_memory_usage(void)
+  {
+      struct rusage usage;
+      getrusage(RUSAGE_SELF, &usage);
+      return (mmm)usage.ru_maxrss * 1024;
+  }
+
+  // @NOTE: MAP_NORESERVE with no access keeps a reservation out of the
+  // overcommit accounting; commit_memory() makes pages usable, and they only
+  // take up RAM once they're first written.
+  static void *
+  reserve_memory(mmm size)
+  {
+      void *result = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      return (result == MAP_FAILED) ? 0 : result;
+  }
+
+  static b32
+  commit_memory(void *base, mmm size)
+  {
+      return (mprotect(base, size, PROT_READ | PROT_WRITE) == 0);
+  }
+
+  static void
+  release_memory(void *base, mmm size)
+  {
+      munmap(base, size);
+  }
+
+  //
+  // Large pages
+  //
+
+  static mmm
+  get_large_page_size(void)
+  {
+      return MB(2);
+  }
+
+  // THP is available to MADV_HUGEPAGE regions in "always" and "madvise" mode.
+  // @NOTE: madvise(MADV_HUGEPAGE) succeeds in "never" mode too and just has
+  // no effect, so the mode has to be read from sysfs. The file isn't there
+  // when the kernel was built without THP.
+  static b32
+  is_transparent_huge_page_enabled(void)
+  {
+      b32 result = false;
+
+      int fd = open("/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY);
+      if (fd >= 0)
+      {
+          char text[64] = {};
+          if (read(fd, text, sizeof(text) - 1) > 0)
+              result = (strstr(text, "[always]") || strstr(text, "[madvise]"));
+          close(fd);
+      }
+      return result;
+  }
+
+  // @NOTE: Transparent huge pages. The reservation is trimmed to start on a
+  // large page and marked MADV_HUGEPAGE, so committed memory is faulted in
+  // 2MB at a time wherever the kernel can find a free 2MB frame, and in 4KB
+  // pages where it can't. Returns 0 if the kernel was built without THP or
+  // its mode is "never". 'size' is a multiple of get_large_page_size().
+  static void *
+  reserve_large_page_memory(mmm size)
+  {
+      if (!is_transparent_huge_page_enabled())
+          return 0;
+
+      mmm large_page_size = get_large_page_size();
+      void *reserved = mmap(0, size + large_page_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (reserved == MAP_FAILED)
+          return 0;
+
+      u8 *result = (u8 *)(((umm)reserved + large_page_size - 1) & ~(umm)(large_page_size - 1));
+      mmm head = (mmm)(result - (u8 *)reserved);
+      if (head)
+          munmap(reserved, head);
+      if (large_page_size - head)
+          munmap(result + size, large_page_size - head);
+
+      if (madvise(result, size, MADV_HUGEPAGE) != 0)
+      {
+          munmap(result, size);
+          result = 0;
+      }
+      return result;
+  }
+
+  // Explicit huge pages from the hugetlb pool, committed up front. Returns 0
+  // when the pool can't cover 'size', which it never can unless
+  // vm.nr_hugepages was raised. 'size' is a multiple of get_large_page_size().
+  static void *
+  allocate_large_pages(mmm size)
+  {
+      void *result = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      return (result == MAP_FAILED) ? 0 : result;
+  }
+
+  static void
+  free_large_pages(void *base, mmm size)
+  {
+      munmap(base, size);
+  }
+
+  static u32
+  get_logical_core_count(void)
+  {
+      return (u32)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+
+  static b32
+  pin_current_thread_to_core(u32 core_index)
+  {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(core_index, &set);
+      b32 result = (sched_setaffinity(0, sizeof(set), &set) == 0);
+      return result;
+  }
+
+  static Buffer
+  map_entire_file(const char *filename)
+  {
+      Buffer result = {};
+
+      int fd = open(filename, O_RDONLY);
+      if (fd >= 0)
+      {
+          struct stat st;
+          if (fstat(fd, &st) == 0 && st.st_size)
+          {
+              void *data = mmap(0, (mmm)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+              if (data != MAP_FAILED)
+              {
+                  result.data = (u8 *)data;
+                  result.size = (mmm)st.st_size;
+              }
+          }
+          close(fd);
+      }
+
+      return result;
+  }
+
+  static void
+  unmap_file(Buffer file)
+  {
+      if (file.data)
+          munmap(file.data, file.size);
+  }
+
+  // @NOTE: Bytes past EOF in the last file page read as zero, but a page that
+  // lies entirely past EOF faults with SIGBUS. So we reserve one byte more than
+  // the file, rounded to pages, as anonymous zero memory and map the file over
+  // the front of it. data[size] is then always 0 without copying anything.
+  static Buffer
+  map_entire_file_and_null_terminate(const char *filename, b32 prefault)
+  {
+      Buffer result = {};
+
+      int fd = open(filename, O_RDONLY);
+      if (fd >= 0)
+      {
+          struct stat st;
+          if (fstat(fd, &st) == 0 && st.st_size)
+          {
+              mmm size = (mmm)st.st_size;
+              void *reserved = mmap(0, size + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+              if (reserved != MAP_FAILED)
+              {
+                  int flags = MAP_PRIVATE | MAP_FIXED;
+                  if (prefault)
+                      flags |= MAP_POPULATE;
+
+                  void *data = mmap(reserved, size, PROT_READ, flags, fd, 0);
+                  if (data != MAP_FAILED)
+                  {
+                      madvise(data, size, MADV_SEQUENTIAL);
+                      if (!prefault)
+                          madvise(data, size, MADV_WILLNEED);
+
+                      result.data = (u8 *)data;
+                      result.size = size;
+                  }
+                  else
+                  {
+                      munmap(reserved, size + 1);
+                  }
+              }
+          }
+          close(fd);
+      }
+
+      return result;
+  }
+
+  static void
+  unmap_null_terminated_file(Buffer file)
+  {
+      if (file.data)
+          munmap(file.data, file.size + 1);
+  }
+
+  // @NOTE: All counters share one perf group so a single read() returns a
+  // consistent snapshot. Counters the kernel refuses (e.g. no PMU passthrough
+  // in a VM) are left out and reported as unavailable.
+  static b32
+  open_pmc_group(Pmc_Group *group)
+  {
+      *group = {};
+      group->leader = -1;
+
+      struct
+      {
+          u32 type;
+          u64 config;
+      } events[Pmc_Counter_Count] =
+      {
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+          {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+          {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+      };
+
+      for (u32 counter = 0; counter < Pmc_Counter_Count; ++counter)
+      {
+          struct perf_event_attr attr = {};
+          attr.size = sizeof(attr);
+          attr.type = events[counter].type;
+          attr.config = events[counter].config;
+          attr.read_format = PERF_FORMAT_GROUP;
+          attr.exclude_kernel = 1;
+          attr.exclude_hv = 1;
+
+          int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, group->leader, 0);
+          group->fds[counter] = fd;
+          if (fd >= 0)
+          {
+              if (group->leader < 0)
+                  group->leader = fd;
+              group->available[counter] = true;
+              group->slots[counter] = group->slot_count++;
+          }
+      }
+
+      return (group->leader >= 0);
+  }
+
+  static void
+  read_pmc_group(Pmc_Group *group, Pmc_Values *values)
+  {
+      u64 data[1 + Pmc_Counter_Count] = {};
+      if (group->leader >= 0)
+          read(group->leader, data, sizeof(data));
+
+      for (u32 counter = 0; counter < Pmc_Counter_Count; ++counter)
+      {
+          values->counts[counter] = (group->available[counter] ? data[1 + group->slots[counter]] : 0);
+      }
+  }
+  //
+  // Threads and synchronization
+  //
+
+  struct Platform_Thread
+  {
+      pthread_t handle;
+      Thread_Proc *proc;
+      void *param;
+  };
+
+  struct Platform_Mutex
+  {
+      pthread_mutex_t lock;
+  };
+
+  struct Platform_Condition
+  {
+      pthread_cond_t variable;
+  };
+
+  static void *
+  linux_thread_trampoline(void *param)
+  {
+      Platform_Thread *thread = (Platform_Thread *)param;
+      thread->proc(thread->param);
+      return 0;
+  }
+
+  // @NOTE: 'thread' must stay alive until join_thread(), the trampoline reads it.
+  static b32
+  create_thread(Platform_Thread *thread, Thread_Proc *proc, void *param)
+  {
+      thread->proc = proc;
+      thread->param = param;
+      return (pthread_create(&thread->handle, 0, linux_thread_trampoline, thread) == 0);
+  }
+
+  static void
+  join_thread(Platform_Thread *thread)
+  {
+      pthread_join(thread->handle, 0);
+  }
+
+  static void init_mutex(Platform_Mutex *mutex)    { pthread_mutex_init(&mutex->lock, 0); }
+  static void destroy_mutex(Platform_Mutex *mutex) { pthread_mutex_destroy(&mutex->lock); }
+  static void lock_mutex(Platform_Mutex *mutex)    { pthread_mutex_lock(&mutex->lock); }
+  static void unlock_mutex(Platform_Mutex *mutex)  { pthread_mutex_unlock(&mutex->lock); }
+
+  static void init_condition(Platform_Condition *condition)      { pthread_cond_init(&condition->variable, 0); }
+  static void destroy_condition(Platform_Condition *condition)   { pthread_cond_destroy(&condition->variable); }
+  static void signal_condition(Platform_Condition *condition)    { pthread_cond_signal(&condition->variable); }
+  static void broadcast_condition(Platform_Condition *condition) { pthread_cond_broadcast(&condition->variable); }
+
+  static void
+  wait_condition(Platform_Condition *condition, Platform_Mutex *mutex)
+  {
+      pthread_cond_wait(&condition->variable, &mutex->lock);
+  }
+
+  static void yield_thread(void) { sched_yield(); }
+
+  static s64
+  atomic_load_s64(volatile s64 *value)
+  {
+      return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+  }
+
+  static void
+  atomic_store_s64(volatile s64 *value, s64 new_value)
+  {
+      __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+  }
+
+  static s64
+  atomic_add_s64(volatile s64 *value, s64 addend)
+  {
+      return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+  }
+
+  static b32
+  atomic_compare_exchange_s64(volatile s64 *value, s64 expected, s64 new_value)
+  {
+      return __atomic_compare_exchange_n(value, &expected, new_value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  }
+
+  static void full_memory_barrier(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+  //
+  // Positional file reads
+  //
+
+  struct Platform_File
+  {
+      int fd;
+  };
+
+  static b32
+  open_file_for_reading(Platform_File *file, const char *filename)
+  {
+      file->fd = open(filename, O_RDONLY);
+      if (file->fd >= 0)
+          posix_fadvise(file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      return (file->fd >= 0);
+  }
+
+  static u64
+  get_file_size(Platform_File *file)
+  {
+      struct stat st = {};
+      fstat(file->fd, &st);
+      return (u64)st.st_size;
+  }
+
+  // @NOTE: Safe to call from several threads at once on the same file.
+  static mmm
+  read_file_at(Platform_File *file, u64 offset, void *dest, mmm size)
+  {
+      mmm result = 0;
+      while (result < size)
+      {
+          ssize_t bytes_read = pread(file->fd, (u8 *)dest + result, size - result, (off_t)(offset + result));
+          if (bytes_read <= 0)
+              break;
+          result += (mmm)bytes_read;
+      }
+      return result;
+  }
+
+  static void
+  close_file(Platform_File *file)
+  {
+      close(file->fd);
+  }
 #else
-  static_assert(0, "no MSVC found.");
+  static_assert(0, "unsupported platform.");
 #endif
 
 
@@ -69,3 +1023,145 @@ estimate_cpu_frequency(void)
     
     return cpu_freq;
 }
+
+// @NOTE: CPUID leaf 0x15 gives the TSC/crystal ratio and, on most recent Intel
+// parts, the crystal frequency itself. When it's zero we don't guess the crystal.
+static u64
+get_tsc_frequency_from_cpuid(void)
+{
+    u64 result = 0;
+
+    u32 eax, ebx, ecx, edx;
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x15)
+    {
+        cpuid(0x15, 0, &eax, &ebx, &ecx, &edx);
+        if (eax && ebx && ecx)
+            result = (u64)ecx * ebx / eax;
+    }
+
+    return result;
+}
+
+// 'dest' holds at least 49 bytes. Empty if the CPU has no brand string.
+static void
+get_cpu_brand_string(char *dest)
+{
+    dest[0] = 0;
+
+    u32 eax, ebx, ecx, edx;
+    cpuid(0x80000000, 0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000004)
+    {
+        u32 *words = (u32 *)dest;
+        for (u32 leaf = 0; leaf < 3; ++leaf)
+            cpuid(0x80000002 + leaf, 0, words + leaf * 4 + 0, words + leaf * 4 + 1, words + leaf * 4 + 2, words + leaf * 4 + 3);
+        dest[48] = 0;
+    }
+}
+
+// @NOTE: The calibration result is kept in a per-user cache directory, so
+// only the first run after a boot pays for the busy-wait in
+// estimate_cpu_frequency(). It's stamped with the CPU brand string and the
+// boot id and only used when both still match: a file left by another
+// machine (a copied home directory, say) or by an earlier boot is ignored
+// and overwritten. Without a cache directory or boot id every run calibrates.
+static u64
+get_cached_cpu_frequency_calibration(void)
+{
+    u64 result = 0;
+
+    char brand[49];
+    char boot_id[64];
+    get_cpu_brand_string(brand);
+    const char *directory = get_cache_directory();
+    if (!directory || !get_boot_id(boot_id, sizeof(boot_id)))
+        return estimate_cpu_frequency();
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/computer_enhance_tsc_frequency.txt", directory);
+
+    char expected_key[128];
+    snprintf(expected_key, sizeof(expected_key), "%s|%s", brand, boot_id);
+
+    FILE *file = fopen(path, "rb");
+    if (file)
+    {
+        char key[128] = {};
+        unsigned long long value = 0;
+        if (fgets(key, sizeof(key), file) && fscanf(file, "%llu", &value) == 1)
+        {
+            mmm length = strlen(key);
+            if (length && key[length - 1] == '\n')
+                key[length - 1] = 0;
+            if (strcmp(key, expected_key) == 0)
+                result = value;
+        }
+        fclose(file);
+    }
+
+    if (!result)
+    {
+        result = estimate_cpu_frequency();
+
+        file = fopen(path, "wb");
+        if (file)
+        {
+            fprintf(file, "%s\n%llu", expected_key, (unsigned long long)result);
+            fclose(file);
+        }
+    }
+
+    return result;
+}
+
+static u64
+get_cpu_timer_frequency(void)
+{
+    local u64 cached_frequency;
+
+    if (!cached_frequency)
+        cached_frequency = get_tsc_frequency_from_cpuid();
+    if (!cached_frequency)
+        cached_frequency = get_tsc_frequency_from_os();
+    if (!cached_frequency)
+        cached_frequency = get_cached_cpu_frequency_calibration();
+
+    return cached_frequency;
+}
+
+struct Cpu_Features
+{
+    b32 avx2;       // Includes FMA3.
+    b32 avx512f;
+};
+
+// What the CPU supports and the OS saves across context switches. A CPU can
+// report AVX-512 while the OS leaves the upper registers out of XCR0.
+static Cpu_Features
+get_cpu_features(void)
+{
+    Cpu_Features result = {};
+
+    u32 eax, ebx, ecx, edx;
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    u32 max_leaf = eax;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    b32 has_osxsave = ((ecx >> 27) & 1);
+    b32 has_avx = ((ecx >> 28) & 1);
+    b32 has_fma = ((ecx >> 12) & 1);
+
+    if (has_osxsave && has_avx && max_leaf >= 7)
+    {
+        u64 xcr0 = read_xcr0();
+        b32 os_saves_ymm = ((xcr0 & 0x06) == 0x06);
+        b32 os_saves_zmm = ((xcr0 & 0xE6) == 0xE6);
+
+        cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+        result.avx2 = (os_saves_ymm && has_fma && ((ebx >> 5) & 1));
+        result.avx512f = (os_saves_zmm && result.avx2 && ((ebx >> 16) & 1));
+    }
+
+    return result;
+}
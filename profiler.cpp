@@ -15,56 +15,142 @@
   #define __PROFILER 0
 #endif
 
+// @NOTE: Reading the PMC group costs a syscall on every block entry and exit,
+// so it's opt-in on top of __PROFILER and best kept off fine-grained blocks.
+#ifndef __PROFILER_PMC
+  #define __PROFILER_PMC 0
+#endif
+
 #if __PROFILER
-  #define time_block(name) Profile_Block CONCAT(block, __LINE__)(name, __COUNTER__ + 1)
+  #define time_block(name) Profile_Block CONCAT(block, __LINE__)(name, __COUNTER__ + 1, 0)
   #define time_function() time_block(__func__)
+  // A block that processes 'byte_count' bytes each time it runs; its
+  // throughput is printed next to its time.
+  #define time_bandwidth(name, byte_count) Profile_Block CONCAT(block, __LINE__)(name, __COUNTER__ + 1, byte_count)
+  // Time measured some other way than a block around it (overlapping
+  // intervals, or time on another thread's behalf), added to the report as
+  // its own top-level line. It isn't taken out of any enclosing block.
+  #define record_profile_interval(name, tsc_elapsed, byte_count) profile_record_interval(name, __COUNTER__ + 1, tsc_elapsed, byte_count)
+
+  #define PROFILER_MAX_ANCHORS            4096
+  #define PROFILER_MAX_THREADS            1024
+  #define PROFILER_IMBALANCE_THRESHOLD    1.2     // Slowest thread over the mean, per anchor.
 
   struct Profile_Anchor
   {
       u64 tsc_elapsed_exclusive;
       u64 tsc_elapsed_inclusive;
       u64 hit_count;
+      u64 processed_byte_count;
       char const *label;
+  #if __PROFILER_PMC
+      u64 pmc_exclusive[Pmc_Counter_Count];
+      u64 pmc_inclusive[Pmc_Counter_Count];
+  #endif
+  };
+  
+  //
+  // @NOTE: Every thread records into an anchor table and parent chain of its
+  // own, so a block only ever touches memory of the thread running it and
+  // needs no synchronization. The tables are merged when the profile is
+  // printed, which has to be after the other threads are done.
+  //
+  struct Profile_Thread
+  {
+      Profile_Anchor anchors[PROFILER_MAX_ANCHORS];
+      u32 parent;
+      u32 index;
+      char const *name;
+  #if __PROFILER_PMC
+      Pmc_Group pmc_group;        // perf counts the thread that opened it only.
+  #endif
   };
   
   struct Profiler
   {
-      Profile_Anchor anchors[4096];
+      Profile_Thread *threads[PROFILER_MAX_THREADS];
+      volatile s64 thread_count;
   
       u64 start_tsc;
       u64 end_tsc;
   };
   static Profiler g_profiler;
-  static u32 g_profiler_parent;
+  static thread_local Profile_Thread *g_profile_thread;
+
+  // Called first thing on a new thread. A thread that enters a block without
+  // having called it gets registered then, without a name.
+  static Profile_Thread *
+  begin_profile_thread(char const *name)
+  {
+      Profile_Thread *thread = g_profile_thread;
+      if (!thread)
+      {
+          s64 index = atomic_add_s64(&g_profiler.thread_count, 1) - 1;
+          assert(index < PROFILER_MAX_THREADS);
+
+          thread = (Profile_Thread *)calloc(1, sizeof(Profile_Thread));
+          thread->index = (u32)index;
+  #if __PROFILER_PMC
+          open_pmc_group(&thread->pmc_group);
+  #endif
+          g_profiler.threads[index] = thread;
+          g_profile_thread = thread;
+      }
+      if (name)
+          thread->name = name;
+      return thread;
+  }
   
   struct Profile_Block
   {
-      Profile_Block(char const *label_, u32 anchor_index_)
+      Profile_Block(char const *label_, u32 anchor_index_, u64 byte_count)
       {
-          parent_index = g_profiler_parent;
+          thread = g_profile_thread;
+          if (!thread)
+              thread = begin_profile_thread(0);
+          parent_index = thread->parent;
   
           anchor_index = anchor_index_;
           label = label_;
   
-          Profile_Anchor *anchor = g_profiler.anchors + anchor_index;
+          Profile_Anchor *anchor = thread->anchors + anchor_index;
           old_tsc_elapsed_inclusive = anchor->tsc_elapsed_inclusive;
+          anchor->processed_byte_count += byte_count;
+  #if __PROFILER_PMC
+          for (u32 counter = 0; counter < Pmc_Counter_Count; ++counter)
+              old_pmc_inclusive.counts[counter] = anchor->pmc_inclusive[counter];
+          read_pmc_group(&thread->pmc_group, &pmc_start);
+  #endif
   
-          g_profiler_parent = anchor_index;
+          thread->parent = anchor_index;
           tsc_start = read_cpu_timer();
       }
   
       ~Profile_Block()
       {
           u64 elapsed = read_cpu_timer() - tsc_start;
-          g_profiler_parent = parent_index;
+  #if __PROFILER_PMC
+          Pmc_Values pmc_end;
+          read_pmc_group(&thread->pmc_group, &pmc_end);
+  #endif
+          thread->parent = parent_index;
   
-          Profile_Anchor *parent = g_profiler.anchors + parent_index;
-          Profile_Anchor *anchor = g_profiler.anchors + anchor_index;
+          Profile_Anchor *parent = thread->anchors + parent_index;
+          Profile_Anchor *anchor = thread->anchors + anchor_index;
   
           parent->tsc_elapsed_exclusive -= elapsed;
           anchor->tsc_elapsed_exclusive += elapsed;
           anchor->tsc_elapsed_inclusive = old_tsc_elapsed_inclusive + elapsed;
           ++anchor->hit_count;
+  #if __PROFILER_PMC
+          for (u32 counter = 0; counter < Pmc_Counter_Count; ++counter)
+          {
+              u64 delta = pmc_end.counts[counter] - pmc_start.counts[counter];
+              parent->pmc_exclusive[counter] -= delta;
+              anchor->pmc_exclusive[counter] += delta;
+              anchor->pmc_inclusive[counter] = old_pmc_inclusive.counts[counter] + delta;
+          }
+  #endif
   
           /* NOTE: This write happens every time solely because there is no
              straightforward way in C++ to have the same ease-of-use. In a better programming
@@ -73,33 +159,146 @@
           anchor->label = label;
       }
   
+      Profile_Thread *thread;
       char const *label;
       u64 old_tsc_elapsed_inclusive;
       u64 tsc_start;
       u32 parent_index;
       u32 anchor_index;
+  #if __PROFILER_PMC
+      Pmc_Values old_pmc_inclusive;
+      Pmc_Values pmc_start;
+  #endif
   };
   
+  static void
+  profile_record_interval(char const *label, u32 anchor_index, u64 tsc_elapsed, u64 byte_count)
+  {
+      Profile_Thread *thread = g_profile_thread;
+      if (!thread)
+          thread = begin_profile_thread(0);
+
+      Profile_Anchor *anchor = thread->anchors + anchor_index;
+      anchor->tsc_elapsed_exclusive += tsc_elapsed;
+      anchor->tsc_elapsed_inclusive += tsc_elapsed;
+      anchor->processed_byte_count += byte_count;
+      ++anchor->hit_count;
+      anchor->label = label;
+  }
+  
   static void
   begin_profile(void)
   {
+      Profile_Thread *thread = begin_profile_thread("main");
+  #if __PROFILER_PMC
+      if (!thread->pmc_group.slot_count)
+          fprintf(stderr, "[WARNING]: Performance counters are unavailable.\n");
+  #endif
       g_profiler.start_tsc = read_cpu_timer();
   }
+
+  #if __PROFILER_PMC
+  static void
+  print_pmc_values(Pmc_Group *group, u64 *counts)
+  {
+      u64 instructions = counts[Pmc_Counter_Instructions];
+      if (group->available[Pmc_Counter_Cycles] && group->available[Pmc_Counter_Instructions] && counts[Pmc_Counter_Cycles])
+          printf(" ipc %.2f", (f64)instructions / (f64)counts[Pmc_Counter_Cycles]);
+      if (group->available[Pmc_Counter_LLC_Misses] && instructions)
+          printf(" llc-miss %.2f/ki", 1000.0 * (f64)counts[Pmc_Counter_LLC_Misses] / (f64)instructions);
+      if (group->available[Pmc_Counter_Branch_Misses] && instructions)
+          printf(" br-miss %.2f/ki", 1000.0 * (f64)counts[Pmc_Counter_Branch_Misses] / (f64)instructions);
+      if (group->available[Pmc_Counter_Page_Faults])
+          printf(" pf %llu", counts[Pmc_Counter_Page_Faults]);
+      if (group->available[Pmc_Counter_DTLB_Misses] && instructions)
+          printf(" dtlb-miss %.2f/ki", 1000.0 * (f64)counts[Pmc_Counter_DTLB_Misses] / (f64)instructions);
+  }
+  #endif
   
+  // Time a thread spent inside blocks at its top level. Anchor 0 is the
+  // parent of those, so its exclusive time is exactly minus that.
+  static u64
+  get_profile_thread_busy_time(Profile_Thread *thread)
+  {
+      return (u64)(-(s64)thread->anchors[0].tsc_elapsed_exclusive);
+  }
+
+  static f64
+  milliseconds_from_tsc(u64 tsc, u64 cpu_frequency)
+  {
+      return (cpu_frequency ? 1000.0 * (f64)tsc / (f64)cpu_frequency : 0.0);
+  }
+  
+  // @NOTE: Times of an anchor that ran on several threads are summed, so
+  // its percentage of the wall-clock total can go past 100%. Its throughput
+  // is taken over the slowest thread's inclusive time instead, which is
+  // about how long the stage held up everything behind it.
   static void
   end_and_print_profile(void)
   {
       g_profiler.end_tsc = read_cpu_timer();
-      u64 cpu_frequency = estimate_cpu_frequency();
+      u64 cpu_frequency = get_cpu_timer_frequency();
   
       u64 total_cpu_elapsed = (g_profiler.end_tsc - g_profiler.start_tsc);
   
       if (cpu_frequency)
           printf("\nTotal time: %.4fms (CPU freq %llu = %.2fGHz)\n", 1000.0 * (f64)total_cpu_elapsed / (f64)cpu_frequency, cpu_frequency, (f64)cpu_frequency / (f64)(1'000'000'000));
   
-      for (u32 anchor_index = 0; anchor_index < array_count(g_profiler.anchors); ++anchor_index)
+      Profile_Thread *threads[PROFILER_MAX_THREADS];
+      u32 thread_count = 0;
+      for (s64 index = 0; index < atomic_load_s64(&g_profiler.thread_count); ++index)
       {
-          Profile_Anchor *anchor = g_profiler.anchors + anchor_index;
+          if (g_profiler.threads[index])
+              threads[thread_count++] = g_profiler.threads[index];
+      }
+
+      if (thread_count > 1)
+      {
+          u64 busy_total = 0;
+          for (u32 index = 0; index < thread_count; ++index)
+              busy_total += get_profile_thread_busy_time(threads[index]);
+
+          printf("Threads: %u, %.4fms busy summed over threads vs %.4fms wall (%.2fx)\n", thread_count,
+                 milliseconds_from_tsc(busy_total, cpu_frequency), milliseconds_from_tsc(total_cpu_elapsed, cpu_frequency),
+                 (f64)busy_total / (f64)total_cpu_elapsed);
+          for (u32 index = 0; index < thread_count; ++index)
+          {
+              Profile_Thread *thread = threads[index];
+              u64 busy = get_profile_thread_busy_time(thread);
+              printf("  thread %u (%s): %.4fms busy (%.2f%% of wall)\n", thread->index, thread->name ? thread->name : "unnamed",
+                     milliseconds_from_tsc(busy, cpu_frequency), 100.0 * (f64)busy / (f64)total_cpu_elapsed);
+          }
+      }
+  
+      for (u32 anchor_index = 0; anchor_index < PROFILER_MAX_ANCHORS; ++anchor_index)
+      {
+          Profile_Anchor merged = {};
+          u32 hit_thread_count = 0;
+          u64 max_tsc_elapsed_inclusive = 0;
+          for (u32 index = 0; index < thread_count; ++index)
+          {
+              Profile_Anchor *anchor = threads[index]->anchors + anchor_index;
+              if (anchor->tsc_elapsed_inclusive)
+              {
+                  merged.tsc_elapsed_exclusive += anchor->tsc_elapsed_exclusive;
+                  merged.tsc_elapsed_inclusive += anchor->tsc_elapsed_inclusive;
+                  merged.hit_count += anchor->hit_count;
+                  merged.processed_byte_count += anchor->processed_byte_count;
+                  merged.label = anchor->label;
+  #if __PROFILER_PMC
+                  for (u32 counter = 0; counter < Pmc_Counter_Count; ++counter)
+                  {
+                      merged.pmc_exclusive[counter] += anchor->pmc_exclusive[counter];
+                      merged.pmc_inclusive[counter] += anchor->pmc_inclusive[counter];
+                  }
+  #endif
+                  ++hit_thread_count;
+                  if (max_tsc_elapsed_inclusive < anchor->tsc_elapsed_inclusive)
+                      max_tsc_elapsed_inclusive = anchor->tsc_elapsed_inclusive;
+              }
+          }
+
+          Profile_Anchor *anchor = &merged;
           if (anchor->tsc_elapsed_inclusive)
           {
               f64 percent = 100.0 * ((f64)anchor->tsc_elapsed_exclusive / (f64)total_cpu_elapsed);
@@ -109,13 +308,59 @@
                   percent = 100.0 * ((f64)anchor->tsc_elapsed_inclusive / (f64)total_cpu_elapsed);
                   printf(", %.2f%% w/children", percent);
               }
-              printf(")\n");
+              printf(")");
+
+              // @NOTE: Inclusive time, so a block's throughput counts the
+              // work its children did on the same bytes.
+              if (anchor->processed_byte_count && cpu_frequency)
+              {
+                  f64 seconds = (f64)max_tsc_elapsed_inclusive / (f64)cpu_frequency;
+                  f64 megabytes = (f64)anchor->processed_byte_count / (f64)MB(1);
+                  f64 megabytes_per_second = megabytes / seconds;
+                  printf("  %.3fmb at %.2fmb/s (%.2fgb/s)", megabytes, megabytes_per_second, megabytes_per_second / 1024.0);
+              }
+              printf("\n");
+  #if __PROFILER_PMC
+              // @NOTE: Every thread's group was opened the same way, so the
+              // main thread's says which counters there are.
+              Pmc_Group *group = &threads[0]->pmc_group;
+              printf("     ");
+              print_pmc_values(group, anchor->pmc_exclusive);
+              if (anchor->tsc_elapsed_inclusive != anchor->tsc_elapsed_exclusive)
+              {
+                  printf(" |");
+                  print_pmc_values(group, anchor->pmc_inclusive);
+                  printf(" w/children");
+              }
+              printf("\n");
+  #endif
+
+              if (hit_thread_count > 1)
+              {
+                  f64 mean = (f64)anchor->tsc_elapsed_inclusive / (f64)hit_thread_count;
+                  f64 imbalance = (f64)max_tsc_elapsed_inclusive / mean;
+
+                  printf("      per thread:");
+                  for (u32 index = 0; index < thread_count; ++index)
+                  {
+                      Profile_Anchor *thread_anchor = threads[index]->anchors + anchor_index;
+                      if (thread_anchor->tsc_elapsed_inclusive)
+                      {
+                          printf(" t%u %.4fms[%llu]", threads[index]->index,
+                                 milliseconds_from_tsc(thread_anchor->tsc_elapsed_inclusive, cpu_frequency), thread_anchor->hit_count);
+                      }
+                  }
+                  printf(" (slowest %.2fx the mean%s)\n", imbalance, (imbalance > PROFILER_IMBALANCE_THRESHOLD) ? ", LOAD IMBALANCE" : "");
+              }
           }
       }
   }
 #else
   #define time_block(...)
   #define time_function(...)
+  #define time_bandwidth(...)
+  #define record_profile_interval(...)
+  static void begin_profile_thread(char const *name) {}
   static void begin_profile(void) {}
   static void end_and_print_profile(void) {}
 #endif
@@ -0,0 +1,102 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   ======================================================================== */
+
+
+
+
+//
+// Seedable random numbers: xoshiro256** with its state filled from
+// splitmix64. Every series is a plain value with no global state, so separate
+// threads (or separate shards of the same output) each own one, and a series
+// is fully decided by its (seed, stream) pair.
+//
+
+struct Random_Series
+{
+    u64 state[4];
+};
+
+static u64
+splitmix64(u64 *state)
+{
+    u64 z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (z ^ (z >> 31));
+}
+
+static u64
+rotate_left_u64(u64 value, u32 shift)
+{
+    return ((value << shift) | (value >> (64 - shift)));
+}
+
+// @NOTE: 'stream' goes through splitmix64 together with the seed, so series
+// for neighbouring streams share nothing that shows up in their output.
+static Random_Series
+seed_random_series(u64 seed, u64 stream)
+{
+    Random_Series result = {};
+    u64 state = seed ^ splitmix64(&stream);
+    for (u32 idx = 0; idx < array_count(result.state); ++idx)
+        result.state[idx] = splitmix64(&state);
+    return result;
+}
+
+static u64
+random_u64(Random_Series *series)
+{
+    u64 *s = series->state;
+    u64 result = rotate_left_u64(s[1] * 5, 7) * 9;
+    u64 t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotate_left_u64(s[3], 45);
+
+    return result;
+}
+
+// [0, 1) with all 53 bits of mantissa random.
+static f64
+random_unilateral(Random_Series *series)
+{
+    return (f64)(random_u64(series) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// [-1, 1)
+static f64
+random_bilateral(Random_Series *series)
+{
+    return 2.0 * random_unilateral(series) - 1.0;
+}
+
+// [0, bound), by the high half of a 64x64 multiply instead of a modulo. The
+// bias is at most bound / 2^64.
+static u64
+random_below(Random_Series *series, u64 bound)
+{
+    u64 x = random_u64(series);
+#ifdef _MSC_VER
+    return __umulh(x, bound);
+#else
+    return (u64)(((unsigned __int128)x * bound) >> 64);
+#endif
+}
+
+// [min, max], both inclusive.
+static s64
+random_between(Random_Series *series, s64 min, s64 max)
+{
+    return min + (s64)random_below(series, (u64)(max - min) + 1);
+}
@@ -0,0 +1,1025 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   ======================================================================== */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "core.h"
+#include "platform.cpp"
+#include "memory.cpp"
+#include "profiler.cpp"
+#include "haversine_shared.cpp"
+#include "job_system.cpp"
+#include "haversine_batch.cpp"
+#include "json_number.cpp"
+#include "json_parser.cpp"
+#include "json_tape.cpp"
+#include "json_direct.cpp"
+#include "json_parallel.cpp"
+#include "json_structural.cpp"
+#include "repetition_tester.cpp"
+
+#ifdef _MSC_VER
+  #include <io.h>
+  #include <fcntl.h>
+  #include <sys/stat.h>
+
+  #define os_open(FILENAME) _open(FILENAME, _O_BINARY | _O_RDONLY)
+  #define os_read _read
+  #define os_close _close
+#else
+  #define os_open(FILENAME) open(FILENAME, O_RDONLY)
+  #define os_read read
+  #define os_close close
+#endif
+
+enum Allocation_Type
+{
+    Allocation_Type_None,
+    Allocation_Type_Malloc,
+    Allocation_Type_Large_Pages,
+
+    Allocation_Type_Count,
+};
+
+struct Test_Parameters
+{
+    Allocation_Type allocation_type;
+    Memory_Arena allocation_arena;      // Backs 'dest' for Allocation_Type_Large_Pages.
+    Buffer dest;
+    char const *filename;
+
+    Buffer source;
+    Memory_Arena *token_arena;
+    Memory_Arena *tree_arena;
+    Memory_Arena *tape_arena;
+    Memory_Arena *column_arena;
+
+    Json_Object tree;
+    Json_Key_Table *keys;
+
+    f64 *coordinates;
+    Haversine_Columns pair_columns;     // The same pairs as 'coordinates'.
+    f64 *distances;
+    mmm pair_count;
+
+    Job_System *jobs;
+    Memory_Arena *job_arena;
+    f64 parallel_sum;
+
+    u32 *number_offsets;
+    mmm number_count;
+    mmm number_byte_count;
+};
+
+typedef void Test_Function(Repetition_Tester *tester, Test_Parameters *params);
+
+struct Test_Function_Entry
+{
+    char const *name;
+    Test_Function *func;
+    Allocation_Type allocation_type;
+};
+
+static char const *
+describe_allocation_type(Allocation_Type allocation_type)
+{
+    char const *result;
+    switch (allocation_type)
+    {
+        case Allocation_Type_None:   { result = "";        } break;
+        case Allocation_Type_Malloc: { result = " + malloc"; } break;
+        case Allocation_Type_Large_Pages: { result = " + large pages"; } break;
+        default:                     { result = " + UNKNOWN"; } break;
+    }
+    return result;
+}
+
+// @NOTE: Every run reads into a fresh allocation on purpose. The allocation
+// and the free themselves happen outside begin_time()/end_time(); what the
+// results pick up is the page faults of the read touching the new memory for
+// the first time.
+static Buffer
+handle_allocation(Repetition_Tester *tester, Test_Parameters *params)
+{
+    Buffer result = params->dest;
+    if (params->allocation_type == Allocation_Type_Malloc)
+    {
+        result.data = (u8 *)malloc(result.size);
+    }
+    else if (params->allocation_type == Allocation_Type_Large_Pages)
+    {
+        init_arena(&params->allocation_arena, result.size, Arena_Flag_Large_Pages);
+        result.data = (u8 *)push_size(&params->allocation_arena, result.size);
+        if (!(params->allocation_arena.flags & Arena_Flag_Large_Pages))
+            error(tester, "large pages are unavailable");
+    }
+    return result;
+}
+
+static void
+handle_deallocation(Test_Parameters *params, Buffer buffer)
+{
+    if (params->allocation_type == Allocation_Type_Malloc)
+        free(buffer.data);
+    else if (params->allocation_type == Allocation_Type_Large_Pages)
+        release_arena(&params->allocation_arena);
+}
+
+static void
+test_fread(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        FILE *file = fopen(params->filename, "rb");
+        if (file)
+        {
+            Buffer dest = handle_allocation(tester, params);
+
+            begin_time(tester);
+            mmm result = fread(dest.data, dest.size, 1, file);
+            end_time(tester);
+
+            if (result == 1)
+                count_bytes(tester, dest.size);
+            else
+                error(tester, "fread failed");
+
+            handle_deallocation(params, dest);
+            fclose(file);
+        }
+        else
+        {
+            error(tester, "fopen failed");
+        }
+    }
+}
+
+static void
+test_read(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        int file = os_open(params->filename);
+        if (file != -1)
+        {
+            Buffer dest = handle_allocation(tester, params);
+
+            u8 *at = dest.data;
+            mmm size_remaining = dest.size;
+            while (size_remaining)
+            {
+                u32 read_size = ((size_remaining > MB(256)) ? (u32)MB(256) : (u32)size_remaining);
+
+                begin_time(tester);
+                s64 result = os_read(file, at, read_size);
+                end_time(tester);
+
+                if (result == (s64)read_size)
+                {
+                    count_bytes(tester, read_size);
+                }
+                else
+                {
+                    error(tester, "read failed");
+                    break;
+                }
+
+                size_remaining -= read_size;
+                at += read_size;
+            }
+
+            handle_deallocation(params, dest);
+            os_close(file);
+        }
+        else
+        {
+            error(tester, "open failed");
+        }
+    }
+}
+
+// @NOTE: Mapping alone doesn't read anything, so every page is touched once to
+// make the comparison with fread/read fair.
+static void
+test_mmap(Repetition_Tester *tester, Test_Parameters *params)
+{
+    mmm page_size = get_page_size();
+    while (is_testing(tester))
+    {
+        begin_time(tester);
+        Buffer file = map_entire_file(params->filename);
+        u64 sum = 0;
+        for (mmm offset = 0; offset < file.size; offset += page_size)
+            sum += file.data[offset];
+        unmap_file(file);
+        end_time(tester);
+
+        if (file.size == params->dest.size)
+            count_bytes(tester, file.size);
+        else
+            error(tester, "mapping failed");
+
+        volatile u64 sink = sum;
+    }
+}
+
+static void
+test_tokenize(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->token_arena);
+
+        begin_time(tester);
+        tokenize(params->source, params->token_arena);
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+    }
+}
+
+static void
+test_tokenize_structural(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->token_arena);
+
+        begin_time(tester);
+        tokenize_structural(params->source, params->token_arena);
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+    }
+}
+
+// @NOTE: The parse tests run on tokens produced once up front, so only the
+// building of the DOM is timed.
+static void
+test_parse_tree(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->tree_arena);
+        Json_Key_Table keys = {};
+
+        begin_time(tester);
+        Json_Object root = parse_json(params->source, params->token_arena, params->tree_arena, &keys);
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+
+        volatile u64 sink = root.used;
+    }
+}
+
+static void
+test_parse_tape(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->tape_arena);
+
+        begin_time(tester);
+        Json_Tape tape = parse_json_tape(params->source, params->token_arena, params->tape_arena);
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+
+        volatile u64 sink = tape.word_count;
+    }
+}
+
+// Tokens and tree in arenas made fresh every run, so their page faults are
+// timed: regular pages for Allocation_Type_Malloc, large ones for
+// Allocation_Type_Large_Pages.
+static void
+test_tokenize_parse_tree(Repetition_Tester *tester, Test_Parameters *params)
+{
+    u32 arena_flags = 0;
+    if (params->allocation_type == Allocation_Type_Large_Pages)
+        arena_flags = Arena_Flag_Large_Pages;
+
+    while (is_testing(tester))
+    {
+        Memory_Arena token_arena = {};
+        Memory_Arena tree_arena = {};
+        Json_Key_Table keys = {};
+
+        begin_time(tester);
+        init_arena(&token_arena, (params->source.size + 1) * sizeof(Token), arena_flags);
+        init_arena(&tree_arena, GB(1), arena_flags);
+        tokenize_structural(params->source, &token_arena);
+        Json_Object root = parse_json(params->source, &token_arena, &tree_arena, &keys);
+        end_time(tester);
+
+        if ((token_arena.flags & tree_arena.flags) == arena_flags)
+            count_bytes(tester, params->source.size);
+        else
+            error(tester, "large pages are unavailable");
+
+        volatile u64 sink = root.used;
+        release_arena(&token_arena);
+        release_arena(&tree_arena);
+    }
+}
+
+// Source to pair columns, straight through the schema-specialized parser...
+static void
+test_columns_direct(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->column_arena);
+        Haversine_Columns columns;
+
+        begin_time(tester);
+        b32 parsed = parse_haversine_columns_direct(params->source, params->column_arena, &columns);
+        end_time(tester);
+
+        if (parsed)
+            count_bytes(tester, params->source.size);
+        else
+            error(tester, "input doesn't match the pair schema");
+    }
+}
+
+// ...split into byte ranges decoded on every core...
+static void
+test_columns_parallel(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->column_arena);
+        Haversine_Columns columns;
+
+        begin_time(tester);
+        b32 parsed = parse_haversine_columns_parallel(params->jobs, params->source, params->column_arena, &columns);
+        end_time(tester);
+
+        if (parsed)
+            count_bytes(tester, params->source.size);
+        else
+            error(tester, "input doesn't match the pair schema");
+    }
+}
+
+// ...and through tokens and the tape.
+static void
+test_columns_generic(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        reset_arena(params->token_arena);
+        reset_arena(params->tape_arena);
+        reset_arena(params->column_arena);
+        Haversine_Columns columns;
+
+        begin_time(tester);
+        tokenize_structural(params->source, params->token_arena);
+        Json_Tape tape = parse_json_tape(params->source, params->token_arena, params->tape_arena);
+        get_haversine_columns_from_tape(&tape, params->column_arena, &columns);
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+    }
+}
+
+// @NOTE: The lookup tests walk a tree parsed once up front and fetch the four
+// fields of every pair, comparing key strings the way lookups used to work
+// against the interned ids json_find uses.
+static void
+test_lookup_string(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 sum = 0.0;
+
+        begin_time(tester);
+        for (u32 field = 0; field < params->tree.used; ++field)
+        {
+            if (get_json_key_string(params->keys, params->tree.key_ids[field]) == "pairs")
+            {
+                Json_Array pairs = params->tree.values[field].array;
+                for (u64 idx = 0; idx < pairs.used; ++idx)
+                {
+                    Json_Object *pair = &pairs.values[idx].object;
+                    for (u32 i = 0; i < pair->used; ++i)
+                    {
+                        String key = get_json_key_string(params->keys, pair->key_ids[i]);
+                        if (key == "x0" || key == "y0" || key == "x1" || key == "y1")
+                            sum += pair->values[i].number;
+                    }
+                }
+            }
+        }
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+
+        volatile f64 sink = sum;
+    }
+}
+
+static void
+test_lookup_interned(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 sum = 0.0;
+
+        begin_time(tester);
+        u32 x0_id = get_json_key_id(params->keys, "x0");
+        u32 y0_id = get_json_key_id(params->keys, "y0");
+        u32 x1_id = get_json_key_id(params->keys, "x1");
+        u32 y1_id = get_json_key_id(params->keys, "y1");
+        Json_Value *pairs_value = json_find(&params->tree, get_json_key_id(params->keys, "pairs"));
+        if (pairs_value)
+        {
+            Json_Array pairs = pairs_value->array;
+            for (u64 idx = 0; idx < pairs.used; ++idx)
+            {
+                Json_Object *pair = &pairs.values[idx].object;
+                sum += (json_find(pair, x0_id)->number + json_find(pair, y0_id)->number +
+                        json_find(pair, x1_id)->number + json_find(pair, y1_id)->number);
+            }
+        }
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+
+        volatile f64 sink = sum;
+    }
+}
+
+static void
+test_structural_scan(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        Json_Scanner scanner;
+        init_json_scanner(&scanner, params->source);
+        u32 index[4096];
+        u64 structural_count = 0;
+
+        begin_time(tester);
+        for (;;)
+        {
+            u32 count = scan_structurals(&scanner, index, array_count(index));
+            if (!count && scanner.offset >= scanner.size)
+                break;
+            structural_count += count;
+        }
+        end_time(tester);
+
+        count_bytes(tester, params->source.size);
+
+        volatile u64 sink = structural_count;
+    }
+}
+
+static void
+test_haversine(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 *c = params->coordinates;
+
+        begin_time(tester);
+        f64 sum = 0.0;
+        for (mmm idx = 0; idx < params->pair_count; ++idx)
+            sum += haversine(c[4*idx + 0], c[4*idx + 1], c[4*idx + 2], c[4*idx + 3]);
+        end_time(tester);
+
+        count_bytes(tester, params->pair_count * 4 * sizeof(f64));
+
+        volatile f64 sink = sum;
+    }
+}
+
+static void
+test_haversine_libm(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 *c = params->coordinates;
+
+        begin_time(tester);
+        f64 sum = 0.0;
+        for (mmm idx = 0; idx < params->pair_count; ++idx)
+            sum += haversine_libm(c[4*idx + 0], c[4*idx + 1], c[4*idx + 2], c[4*idx + 3]);
+        end_time(tester);
+
+        count_bytes(tester, params->pair_count * 4 * sizeof(f64));
+
+        volatile f64 sink = sum;
+    }
+}
+
+static void
+run_haversine_batch_test(Repetition_Tester *tester, Test_Parameters *params, Haversine_Kernel kernel)
+{
+    if (!is_haversine_kernel_supported(kernel))
+    {
+        error(tester, "kernel not supported on this cpu");
+        return;
+    }
+
+    Haversine_Batch_Function *batch_function = get_haversine_batch_function(kernel);
+    Haversine_Columns *columns = &params->pair_columns;
+    while (is_testing(tester))
+    {
+        begin_time(tester);
+        batch_function(columns->x0, columns->y0, columns->x1, columns->y1, columns->count, params->distances);
+        end_time(tester);
+
+        count_bytes(tester, params->pair_count * 4 * sizeof(f64));
+    }
+}
+
+static void
+test_haversine_batch_scalar(Repetition_Tester *tester, Test_Parameters *params)
+{
+    run_haversine_batch_test(tester, params, Haversine_Kernel_Scalar);
+}
+
+static void
+test_haversine_batch_avx2(Repetition_Tester *tester, Test_Parameters *params)
+{
+    run_haversine_batch_test(tester, params, Haversine_Kernel_AVX2);
+}
+
+static void
+test_haversine_batch_avx512(Repetition_Tester *tester, Test_Parameters *params)
+{
+    run_haversine_batch_test(tester, params, Haversine_Kernel_AVX512);
+}
+
+static void
+test_haversine_parallel(Repetition_Tester *tester, Test_Parameters *params)
+{
+    Haversine_Columns *columns = &params->pair_columns;
+    while (is_testing(tester))
+    {
+        begin_time(tester);
+        params->parallel_sum = parallel_haversine_sum_columns(params->jobs, columns->x0, columns->y0, columns->x1, columns->y1,
+                                                              columns->count, params->job_arena);
+        end_time(tester);
+
+        count_bytes(tester, params->pair_count * 4 * sizeof(f64));
+    }
+}
+
+static b32
+is_haversine_test(Test_Function *func)
+{
+    return (func == test_haversine_libm || func == test_haversine || func == test_haversine_batch_scalar ||
+            func == test_haversine_batch_avx2 || func == test_haversine_batch_avx512);
+}
+
+// @NOTE: The number routine the tokenizer used before json_number.cpp, kept
+// here only as the baseline. Digits are accumulated in f64, so it isn't
+// correctly rounded, and it doesn't know about '-' or exponents.
+static f64
+legacy_get_number_from_stream(Stream *stream)
+{
+    f64 n = 0.0;
+    while (is_number(*stream->at))
+    {
+        n = n * 10.0 + (f64)(*stream->at - '0');
+        ++stream->at;
+    }
+
+    if (*stream->at == '.')
+        ++stream->at;
+
+    f64 m = 0.1;
+    while (is_number(*stream->at))
+    {
+        n += m * (f64)(*stream->at - '0');
+        ++stream->at;
+        m /= 10.0;
+    }
+
+    return n;
+}
+
+static void
+test_number_legacy(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 sum = 0.0;
+
+        begin_time(tester);
+        for (mmm idx = 0; idx < params->number_count; ++idx)
+        {
+            Stream stream = {params->source.data + params->number_offsets[idx]};
+            sum += legacy_get_number_from_stream(&stream);
+        }
+        end_time(tester);
+
+        count_bytes(tester, params->number_byte_count);
+
+        volatile f64 sink = sum;
+    }
+}
+
+static void
+test_number(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 sum = 0.0;
+
+        begin_time(tester);
+        for (mmm idx = 0; idx < params->number_count; ++idx)
+        {
+            Stream stream = {params->source.data + params->number_offsets[idx]};
+            sum += json_get_number_from_stream(&stream);
+        }
+        end_time(tester);
+
+        count_bytes(tester, params->number_byte_count);
+
+        volatile f64 sink = sum;
+    }
+}
+
+static void
+test_number_strtod(Repetition_Tester *tester, Test_Parameters *params)
+{
+    while (is_testing(tester))
+    {
+        f64 sum = 0.0;
+
+        begin_time(tester);
+        for (mmm idx = 0; idx < params->number_count; ++idx)
+            sum += strtod((char *)params->source.data + params->number_offsets[idx], 0);
+        end_time(tester);
+
+        count_bytes(tester, params->number_byte_count);
+
+        volatile f64 sink = sum;
+    }
+}
+
+// Finds every number in the source with the structural scanner, and checks the
+// number parser against strtod on all of them while it's at it.
+static void
+collect_numbers(Test_Parameters *params, Memory_Arena *arena)
+{
+    Json_Scanner scanner;
+    init_json_scanner(&scanner, params->source);
+    u32 index[4096];
+
+    params->number_offsets = (u32 *)(arena->base + arena->used);
+    params->number_count = 0;
+    params->number_byte_count = 0;
+
+    mmm mismatch_count = 0;
+    mmm legacy_mismatch_count = 0;
+    for (;;)
+    {
+        u32 count = scan_structurals(&scanner, index, array_count(index));
+        if (!count && scanner.offset >= scanner.size)
+            break;
+
+        for (u32 idx = 0; idx < count; ++idx)
+        {
+            mmm offset = scanner.batch_offset + index[idx];
+            u8 *at = params->source.data + offset;
+            if (is_number(*at) || *at == '-')
+            {
+                *push_struct(arena, u32) = (u32)offset;
+                ++params->number_count;
+
+                Stream stream = {at};
+                f64 value = json_get_number_from_stream(&stream);
+                params->number_byte_count += (mmm)(stream.at - at);
+
+                Stream legacy_stream = {at};
+                f64 legacy_value = legacy_get_number_from_stream(&legacy_stream);
+
+                f64 expected = strtod((char *)at, 0);
+                mismatch_count += (memcmp(&value, &expected, sizeof(f64)) != 0);
+                legacy_mismatch_count += (memcmp(&legacy_value, &expected, sizeof(f64)) != 0);
+            }
+        }
+    }
+
+    printf("%llu numbers, %llu differ from strtod (legacy: %llu)\n",
+           (u64)params->number_count, (u64)mismatch_count, (u64)legacy_mismatch_count);
+}
+
+int main(int argc, char **args)
+{
+    char const *filename = haversine_json_filename;
+    u32 seconds_to_try = 10;
+    if (argc > 1)
+        filename = args[1];
+    if (argc > 2)
+        seconds_to_try = (u32)atoi(args[2]);
+
+    Buffer mapped = map_entire_file(filename);
+    if (!mapped.data)
+    {
+        fprintf(stderr, "[ERROR]: Couldn't open %s\n", filename);
+        return 1;
+    }
+    mmm file_size = mapped.size;
+
+    Memory_Arena file_arena = {};
+    Memory_Arena token_arena = {};
+    Memory_Arena haversine_arena = {};
+    Memory_Arena number_arena = {};
+    Memory_Arena tree_arena = {};
+    Memory_Arena tape_arena = {};
+    Memory_Arena column_arena = {};
+    Memory_Arena lookup_arena = {};
+    init_arena(&file_arena, file_size + 1);
+    init_arena(&token_arena, (file_size + 1) * sizeof(Token));
+
+    Test_Parameters params = {};
+    params.filename = filename;
+    params.dest.size = file_size;
+    params.dest.data = (u8 *)push_size(&file_arena, file_size + 1);
+    params.token_arena = &token_arena;
+
+    memcpy(params.dest.data, mapped.data, file_size);
+    params.dest.data[file_size] = 0;
+    params.source = params.dest;
+    unmap_file(mapped);
+
+    params.pair_count = 1'000'000;
+    mmm coordinate_count = params.pair_count * 4;
+    init_arena(&haversine_arena, params.pair_count * 9 * sizeof(f64));
+    params.coordinates = push_array(&haversine_arena, f64, coordinate_count);
+    params.distances = push_array(&haversine_arena, f64, params.pair_count);
+
+    Haversine_Columns *pair_columns = &params.pair_columns;
+#define X(NAME) pair_columns->NAME = push_array(&haversine_arena, f64, params.pair_count);
+    HAVERSINE_PAIR_FIELDS(X)
+#undef X
+    pair_columns->count = params.pair_count;
+
+    // Edge cases first (same point, poles, antipodes, the date line), then random pairs over the whole globe.
+    f64 edge_pairs[][4] =
+    {
+        {0.0, 0.0, 0.0, 0.0},
+        {10.0, 20.0, 10.0, 20.0},
+        {0.0, 90.0, 0.0, -90.0},
+        {-180.0, 0.0, 0.0, 0.0},
+        {0.0, 0.0, 180.0, 0.0},
+        {179.9, 89.9, -0.1, -89.9},
+        {-179.999999, 45.0, 179.999999, 45.0},
+        {45.0, 1e-9, 45.0, -1e-9},
+    };
+    for (mmm idx = 0; idx < params.pair_count; ++idx)
+    {
+        f64 *c = params.coordinates + 4*idx;
+        if (idx < array_count(edge_pairs))
+        {
+            memcpy(c, edge_pairs[idx], sizeof(edge_pairs[idx]));
+        }
+        else
+        {
+            c[0] = 360.0 * (f64)rand() / (f64)RAND_MAX - 180.0;
+            c[1] = 180.0 * (f64)rand() / (f64)RAND_MAX - 90.0;
+            c[2] = 360.0 * (f64)rand() / (f64)RAND_MAX - 180.0;
+            c[3] = 180.0 * (f64)rand() / (f64)RAND_MAX - 90.0;
+        }
+        pair_columns->x0[idx] = c[0];
+        pair_columns->y0[idx] = c[1];
+        pair_columns->x1[idx] = c[2];
+        pair_columns->y1[idx] = c[3];
+    }
+
+    for (u32 kernel = 0; kernel < Haversine_Kernel_Count; ++kernel)
+    {
+        if (is_haversine_kernel_supported((Haversine_Kernel)kernel))
+        {
+            f64 max_error = validate_haversine_batch((Haversine_Kernel)kernel, pair_columns->x0, pair_columns->y0,
+                                                     pair_columns->x1, pair_columns->y1, pair_columns->count, params.distances);
+            printf("haversine batch (%s): max relative error %.3e vs haversine_libm() (limit %.0e)%s\n",
+                   get_haversine_kernel_name((Haversine_Kernel)kernel), max_error, HAVERSINE_BATCH_MAX_RELATIVE_ERROR,
+                   (max_error <= HAVERSINE_BATCH_MAX_RELATIVE_ERROR) ? "" : " FAILED");
+        }
+    }
+
+    init_arena(&number_arena, file_size * sizeof(u32) / 2 + KB(4));
+    collect_numbers(&params, &number_arena);
+
+    // Tokens for the parse tests; the tokenize tests overwrite them with the same thing.
+    tokenize_structural(params.source, &token_arena);
+    mmm token_count = token_arena.used / sizeof(Token);
+
+    init_arena(&tree_arena, GB(1));
+    init_arena(&tape_arena, (token_count * 2 + 1) * sizeof(u64));
+    params.tree_arena = &tree_arena;
+    params.tape_arena = &tape_arena;
+
+    mmm column_size = (file_size / HAVERSINE_MIN_PAIR_SIZE + 1) * Haversine_Field_Count * sizeof(f64);
+    init_arena(&column_arena, column_size);
+    params.column_arena = &column_arena;
+
+    Memory_Arena table_job_arena = {};
+    Job_System table_jobs = {};
+    init_arena(&table_job_arena, get_logical_core_count() * (sizeof(Job_Worker) + JOB_DEQUE_CAPACITY * sizeof(u32)) + KB(64));
+    init_job_system(&table_jobs, get_logical_core_count(), false, &table_job_arena);
+    params.jobs = &table_jobs;
+
+    // The parallel parse has to give exactly the serial columns.
+    {
+        Memory_Arena serial_arena = {};
+        init_arena(&serial_arena, column_size);
+
+        Haversine_Columns serial_columns;
+        Haversine_Columns parallel_columns;
+        b32 same_columns = parse_haversine_columns_direct(params.source, &serial_arena, &serial_columns);
+        same_columns = (same_columns && parse_haversine_columns_parallel(&table_jobs, params.source, &column_arena, &parallel_columns));
+        same_columns = (same_columns && serial_columns.count == parallel_columns.count);
+#define X(NAME) same_columns = (same_columns && memcmp(serial_columns.NAME, parallel_columns.NAME, serial_columns.count * sizeof(f64)) == 0);
+        HAVERSINE_PAIR_FIELDS(X)
+#undef X
+        printf("columns (parallel, %u threads) match serial: %s\n", table_jobs.worker_count, same_columns ? "yes" : "NO");
+        reset_arena(&column_arena);
+        release_arena(&serial_arena);
+    }
+
+    Json_Key_Table keys = {};
+    parse_json(params.source, &token_arena, &tree_arena, &keys);
+    parse_json_tape(params.source, &token_arena, &tape_arena);
+    printf("DOM memory: tree %.2fmb, tape %.2fmb (tokens %.2fmb)\n",
+           (f64)tree_arena.used / (f64)MB(1), (f64)tape_arena.used / (f64)MB(1), (f64)token_arena.used / (f64)MB(1));
+
+    // A tree of its own for the lookup tests, since the parse test keeps rebuilding tree_arena.
+    init_arena(&lookup_arena, tree_arena.used + MB(1));
+    Json_Key_Table lookup_keys = {};
+    params.tree = parse_json(params.source, &token_arena, &lookup_arena, &lookup_keys);
+    params.keys = &lookup_keys;
+
+    mmm tree_pair_count = 0;
+    Json_Value *tree_pairs = json_find(&params.tree, get_json_key_id(&lookup_keys, "pairs"));
+    if (tree_pairs)
+        tree_pair_count = tree_pairs->array.used;
+
+    Test_Function_Entry entries[] =
+    {
+        {"fread",     test_fread,     Allocation_Type_None},
+        {"fread",     test_fread,     Allocation_Type_Malloc},
+        {"read",      test_read,      Allocation_Type_None},
+        {"read",      test_read,      Allocation_Type_Malloc},
+        {"read",      test_read,      Allocation_Type_Large_Pages},
+        {"mmap",      test_mmap,      Allocation_Type_None},
+        {"tokenize",  test_tokenize,  Allocation_Type_None},
+        {"tokenize (structural)", test_tokenize_structural, Allocation_Type_None},
+        {"structural scan", test_structural_scan, Allocation_Type_None},
+        {"parse (tree)", test_parse_tree, Allocation_Type_None},
+        {"parse (tape)", test_parse_tape, Allocation_Type_None},
+        {"tokenize + parse (tree)", test_tokenize_parse_tree, Allocation_Type_Malloc},
+        {"tokenize + parse (tree)", test_tokenize_parse_tree, Allocation_Type_Large_Pages},
+        {"columns (direct)",  test_columns_direct,  Allocation_Type_None},
+        {"columns (parallel)", test_columns_parallel, Allocation_Type_None},
+        {"columns (generic)", test_columns_generic, Allocation_Type_None},
+        {"lookup (string)",   test_lookup_string,   Allocation_Type_None},
+        {"lookup (interned)", test_lookup_interned, Allocation_Type_None},
+        {"haversine (libm)",   test_haversine_libm,         Allocation_Type_None},
+        {"haversine",          test_haversine,              Allocation_Type_None},
+        {"haversine (batch)",  test_haversine_batch_scalar, Allocation_Type_None},
+        {"haversine (avx2)",   test_haversine_batch_avx2,   Allocation_Type_None},
+        {"haversine (avx512)", test_haversine_batch_avx512, Allocation_Type_None},
+        {"number (legacy)", test_number_legacy, Allocation_Type_None},
+        {"number",          test_number,        Allocation_Type_None},
+        {"number (strtod)", test_number_strtod, Allocation_Type_None},
+    };
+    Repetition_Tester testers[array_count(entries)] = {};
+
+    u64 cpu_timer_frequency = get_cpu_timer_frequency();
+
+    // For the dTLB misses, when the kernel lets us count them.
+    Pmc_Group pmc_group = {};
+    open_pmc_group(&pmc_group);
+    b32 has_dtlb_misses = pmc_group.available[Pmc_Counter_DTLB_Misses];
+
+    for (u32 entry_index = 0; entry_index < array_count(entries); ++entry_index)
+    {
+        Test_Function_Entry *entry = entries + entry_index;
+        Repetition_Tester *tester = testers + entry_index;
+        tester->pmc_group = &pmc_group;
+
+        u64 byte_count = file_size;
+        if (is_haversine_test(entry->func))
+            byte_count = params.pair_count * 4 * sizeof(f64);
+        else if (entry->func == test_number_legacy || entry->func == test_number || entry->func == test_number_strtod)
+            byte_count = params.number_byte_count;
+
+        printf("\n--- %s%s ---\n", entry->name, describe_allocation_type(entry->allocation_type));
+        params.allocation_type = entry->allocation_type;
+        new_test_wave(tester, byte_count, cpu_timer_frequency, seconds_to_try);
+        entry->func(tester, &params);
+    }
+
+    printf("\n%-38s %14s %14s %14s %10s %12s %12s %12s\n", "test", "min (ms)", "max (ms)", "avg (ms)", "gb/s", "faults/run", "dtlb/run", "M items/s");
+    for (u32 entry_index = 0; entry_index < array_count(entries); ++entry_index)
+    {
+        Test_Function_Entry *entry = entries + entry_index;
+        Repetition_Test_Results *results = &testers[entry_index].results;
+
+        u64 test_count = results->total.e[Repetition_Value_Type_Test_Count];
+        if (test_count)
+        {
+            f64 min_seconds = seconds_from_cpu_time((f64)results->min.e[Repetition_Value_Type_CPU_Timer], cpu_timer_frequency);
+            f64 max_seconds = seconds_from_cpu_time((f64)results->max.e[Repetition_Value_Type_CPU_Timer], cpu_timer_frequency);
+            f64 avg_seconds = seconds_from_cpu_time((f64)results->total.e[Repetition_Value_Type_CPU_Timer] / (f64)test_count, cpu_timer_frequency);
+            f64 gb_per_second = (f64)results->min.e[Repetition_Value_Type_Byte_Count] / ((f64)GB(1) * min_seconds);
+            f64 faults_per_run = (f64)results->total.e[Repetition_Value_Type_Page_Faults] / (f64)test_count;
+            f64 dtlb_misses_per_run = (f64)results->total.e[Repetition_Value_Type_DTLB_Misses] / (f64)test_count;
+
+            // Items are pairs for haversine and the lookups, and numbers for the number parsers.
+            mmm item_count = 0;
+            if (is_haversine_test(entry->func))
+                item_count = params.pair_count;
+            else if (entry->func == test_lookup_string || entry->func == test_lookup_interned)
+                item_count = tree_pair_count;
+            else if (entry->func == test_number_legacy || entry->func == test_number || entry->func == test_number_strtod)
+                item_count = params.number_count;
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s%s", entry->name, describe_allocation_type(entry->allocation_type));
+            printf("%-38s %14.4f %14.4f %14.4f %10.4f %12.1f", name, 1000.0 * min_seconds, 1000.0 * max_seconds, 1000.0 * avg_seconds, gb_per_second, faults_per_run);
+            if (has_dtlb_misses)
+                printf(" %12.0f", dtlb_misses_per_run);
+            else
+                printf(" %12s", "-");
+            if (item_count)
+                printf(" %12.1f", (f64)item_count / (1000000.0 * min_seconds));
+            printf("\n");
+        }
+    }
+
+    shutdown_job_system(&table_jobs);
+
+    //
+    // Scaling of the parallel haversine sum, 1 thread up to every core (or
+    // args[3]). The sum has to come out bit-identical for every thread count.
+    //
+    u32 max_thread_count = get_logical_core_count();
+    if (argc > 3)
+        max_thread_count = (u32)atoi(args[3]);
+    if (max_thread_count < 1)
+        max_thread_count = 1;
+
+    u32 thread_counts[32];
+    u32 thread_count_count = 0;
+    for (u32 thread_count = 1; thread_count < max_thread_count && thread_count_count < array_count(thread_counts) - 1; thread_count *= 2)
+        thread_counts[thread_count_count++] = thread_count;
+    thread_counts[thread_count_count++] = max_thread_count;
+
+    Memory_Arena job_arena = {};
+    init_arena(&job_arena, max_thread_count * (sizeof(Job_Worker) + JOB_DEQUE_CAPACITY * sizeof(u32)) + JOB_DEQUE_CAPACITY * sizeof(f64) + KB(64));
+    params.job_arena = &job_arena;
+
+    f64 scaling_seconds[array_count(thread_counts)];
+    f64 scaling_sums[array_count(thread_counts)];
+    for (u32 count_index = 0; count_index < thread_count_count; ++count_index)
+    {
+        Job_System jobs = {};
+        reset_arena(&job_arena);
+        init_job_system(&jobs, thread_counts[count_index], false, &job_arena);
+        params.jobs = &jobs;
+
+        Repetition_Tester tester = {};
+        printf("\n--- haversine (parallel, %u threads) ---\n", thread_counts[count_index]);
+        new_test_wave(&tester, params.pair_count * 4 * sizeof(f64), cpu_timer_frequency, seconds_to_try);
+        test_haversine_parallel(&tester, &params);
+
+        scaling_seconds[count_index] = seconds_from_cpu_time((f64)tester.results.min.e[Repetition_Value_Type_CPU_Timer], cpu_timer_frequency);
+        scaling_sums[count_index] = params.parallel_sum;
+        shutdown_job_system(&jobs);
+    }
+
+    printf("\n%-8s %14s %12s %10s %12s %10s\n", "threads", "min (ms)", "M pairs/s", "speedup", "efficiency", "same sum");
+    for (u32 count_index = 0; count_index < thread_count_count; ++count_index)
+    {
+        f64 speedup = scaling_seconds[0] / scaling_seconds[count_index];
+        b32 same_sum = (memcmp(&scaling_sums[count_index], &scaling_sums[0], sizeof(f64)) == 0);
+        printf("%-8u %14.4f %12.1f %9.2fx %11.1f%% %10s\n", thread_counts[count_index], 1000.0 * scaling_seconds[count_index],
+               (f64)params.pair_count / (1000000.0 * scaling_seconds[count_index]), speedup,
+               100.0 * speedup / (f64)thread_counts[count_index], same_sum ? "yes" : "NO");
+    }
+
+    return 0;
+}
@@ -0,0 +1,258 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Sung Woo Lee, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   ======================================================================== */
+
+
+
+
+enum Test_Mode
+{
+    Test_Mode_Uninitialized,
+    Test_Mode_Testing,
+    Test_Mode_Completed,
+    Test_Mode_Error,
+};
+
+enum Repetition_Value_Type
+{
+    Repetition_Value_Type_Test_Count,
+    Repetition_Value_Type_CPU_Timer,
+    Repetition_Value_Type_Page_Faults,
+    Repetition_Value_Type_Byte_Count,
+    Repetition_Value_Type_DTLB_Misses,
+
+    Repetition_Value_Type_Count,
+};
+
+struct Repetition_Value
+{
+    u64 e[Repetition_Value_Type_Count];
+};
+
+struct Repetition_Test_Results
+{
+    Repetition_Value total;
+    Repetition_Value min;
+    Repetition_Value max;
+};
+
+struct Repetition_Tester
+{
+    u64 target_processed_byte_count;
+    u64 cpu_timer_frequency;
+    u64 try_for_time;
+    u64 tests_started_at;
+
+    Test_Mode mode;
+    b32 print_new_minimums;
+    u32 open_block_count;
+    u32 close_block_count;
+
+    // Optional. dTLB misses are only counted when this is set and the
+    // counter is available.
+    Pmc_Group *pmc_group;
+
+    Repetition_Value accumulated_on_this_test;
+    Repetition_Test_Results results;
+};
+
+static f64
+seconds_from_cpu_time(f64 cpu_time, u64 cpu_timer_frequency)
+{
+    f64 result = 0.0;
+    if (cpu_timer_frequency)
+        result = (cpu_time / (f64)cpu_timer_frequency);
+    return result;
+}
+
+static void
+print_value(char const *label, Repetition_Value value, u64 cpu_timer_frequency)
+{
+    u64 test_count = value.e[Repetition_Value_Type_Test_Count];
+    f64 divisor = (test_count ? (f64)test_count : 1.0);
+
+    f64 e[Repetition_Value_Type_Count];
+    for (u32 idx = 0; idx < array_count(e); ++idx)
+        e[idx] = (f64)value.e[idx] / divisor;
+
+    printf("%s: %.0f", label, e[Repetition_Value_Type_CPU_Timer]);
+    if (cpu_timer_frequency)
+    {
+        f64 seconds = seconds_from_cpu_time(e[Repetition_Value_Type_CPU_Timer], cpu_timer_frequency);
+        printf(" (%fms)", 1000.0 * seconds);
+
+        if (e[Repetition_Value_Type_Byte_Count] > 0)
+        {
+            f64 gigabyte = (1024.0 * 1024.0 * 1024.0);
+            f64 bandwidth = e[Repetition_Value_Type_Byte_Count] / (gigabyte * seconds);
+            printf(" %fgb/s", bandwidth);
+        }
+    }
+
+    if (e[Repetition_Value_Type_Page_Faults] > 0)
+    {
+        printf(" PF: %0.4f (%0.4fk/fault)", e[Repetition_Value_Type_Page_Faults],
+               e[Repetition_Value_Type_Byte_Count] / (e[Repetition_Value_Type_Page_Faults] * 1024.0));
+    }
+
+    if (e[Repetition_Value_Type_DTLB_Misses] > 0)
+        printf(" dTLB: %0.0f", e[Repetition_Value_Type_DTLB_Misses]);
+}
+
+static void
+print_results(Repetition_Test_Results results, u64 cpu_timer_frequency)
+{
+    print_value("Min", results.min, cpu_timer_frequency);
+    printf("\n");
+    print_value("Max", results.max, cpu_timer_frequency);
+    printf("\n");
+    if (results.total.e[Repetition_Value_Type_Test_Count])
+    {
+        print_value("Avg", results.total, cpu_timer_frequency);
+        printf("\n");
+    }
+}
+
+static void
+error(Repetition_Tester *tester, char const *message)
+{
+    tester->mode = Test_Mode_Error;
+    fprintf(stderr, "ERROR: %s\n", message);
+}
+
+static void
+new_test_wave(Repetition_Tester *tester, u64 target_processed_byte_count, u64 cpu_timer_frequency, u32 seconds_to_try = 10)
+{
+    if (tester->mode == Test_Mode_Uninitialized)
+    {
+        tester->mode = Test_Mode_Testing;
+        tester->target_processed_byte_count = target_processed_byte_count;
+        tester->cpu_timer_frequency = cpu_timer_frequency;
+        tester->print_new_minimums = true;
+        tester->results.min.e[Repetition_Value_Type_CPU_Timer] = (u64)-1;
+    }
+    else if (tester->mode == Test_Mode_Completed)
+    {
+        tester->mode = Test_Mode_Testing;
+
+        if (tester->target_processed_byte_count != target_processed_byte_count)
+            error(tester, "target_processed_byte_count changed");
+
+        if (tester->cpu_timer_frequency != cpu_timer_frequency)
+            error(tester, "CPU frequency changed");
+    }
+
+    tester->try_for_time = seconds_to_try * cpu_timer_frequency;
+    tester->tests_started_at = read_cpu_timer();
+}
+
+static u64
+read_dtlb_miss_count(Repetition_Tester *tester)
+{
+    u64 result = 0;
+    if (tester->pmc_group && tester->pmc_group->available[Pmc_Counter_DTLB_Misses])
+    {
+        Pmc_Values values;
+        read_pmc_group(tester->pmc_group, &values);
+        result = values.counts[Pmc_Counter_DTLB_Misses];
+    }
+    return result;
+}
+
+static void
+begin_time(Repetition_Tester *tester)
+{
+    ++tester->open_block_count;
+
+    Repetition_Value *accum = &tester->accumulated_on_this_test;
+    accum->e[Repetition_Value_Type_DTLB_Misses] -= read_dtlb_miss_count(tester);
+    accum->e[Repetition_Value_Type_Page_Faults] -= read_os_page_fault_count();
+    accum->e[Repetition_Value_Type_CPU_Timer] -= read_cpu_timer();
+}
+
+static void
+end_time(Repetition_Tester *tester)
+{
+    Repetition_Value *accum = &tester->accumulated_on_this_test;
+    accum->e[Repetition_Value_Type_CPU_Timer] += read_cpu_timer();
+    accum->e[Repetition_Value_Type_Page_Faults] += read_os_page_fault_count();
+    accum->e[Repetition_Value_Type_DTLB_Misses] += read_dtlb_miss_count(tester);
+
+    ++tester->close_block_count;
+}
+
+static void
+count_bytes(Repetition_Tester *tester, u64 byte_count)
+{
+    Repetition_Value *accum = &tester->accumulated_on_this_test;
+    accum->e[Repetition_Value_Type_Byte_Count] += byte_count;
+}
+
+// @NOTE: A wave keeps going until no new minimum has shown up for try_for_time,
+// so noisy runs just extend the wave instead of polluting the result.
+static b32
+is_testing(Repetition_Tester *tester)
+{
+    if (tester->mode == Test_Mode_Testing)
+    {
+        Repetition_Value accum = tester->accumulated_on_this_test;
+        u64 current_time = read_cpu_timer();
+
+        if (tester->open_block_count)
+        {
+            if (tester->open_block_count != tester->close_block_count)
+                error(tester, "Unbalanced begin_time/end_time");
+
+            if (accum.e[Repetition_Value_Type_Byte_Count] != tester->target_processed_byte_count)
+                error(tester, "Processed byte count mismatch");
+
+            if (tester->mode == Test_Mode_Testing)
+            {
+                Repetition_Test_Results *results = &tester->results;
+
+                accum.e[Repetition_Value_Type_Test_Count] = 1;
+                for (u32 idx = 0; idx < array_count(accum.e); ++idx)
+                    results->total.e[idx] += accum.e[idx];
+
+                if (results->max.e[Repetition_Value_Type_CPU_Timer] < accum.e[Repetition_Value_Type_CPU_Timer])
+                    results->max = accum;
+
+                if (results->min.e[Repetition_Value_Type_CPU_Timer] > accum.e[Repetition_Value_Type_CPU_Timer])
+                {
+                    results->min = accum;
+
+                    // @NOTE: Whenever we get a new minimum time, we reset the clock to the full trial time.
+                    tester->tests_started_at = current_time;
+
+                    if (tester->print_new_minimums)
+                    {
+                        print_value("Min", results->min, tester->cpu_timer_frequency);
+                        printf("                                   \r");
+                        fflush(stdout);
+                    }
+                }
+
+                tester->open_block_count = 0;
+                tester->close_block_count = 0;
+                tester->accumulated_on_this_test = {};
+            }
+        }
+
+        if ((current_time - tester->tests_started_at) > tester->try_for_time)
+        {
+            tester->mode = Test_Mode_Completed;
+
+            printf("                                                          \r");
+            print_results(tester->results, tester->cpu_timer_frequency);
+        }
+    }
+
+    b32 result = (tester->mode == Test_Mode_Testing);
+    return result;
+}